@@ -0,0 +1,140 @@
+#include "graphs.hpp"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+namespace nl = nlohmann;
+
+static const std::string timestamp = "2022-01-01T00:00:00.000Z";
+
+static std::string get_id(std::string_view scope, size_t index) {
+	return std::string(scope) + "/package-" + std::to_string(index);
+}
+
+static std::string get_version(size_t index) {
+	return "1." + std::to_string(index) + ".0";
+}
+
+// Dependencies of each package by index, all of them come after it
+static std::vector<std::vector<size_t>> get_dependencies(const bench::graph_options &options) {
+	size_t count = options.package_count, fan_out = std::max<size_t>(options.fan_out, 1);
+	std::vector<std::vector<size_t>> dependencies(count);
+
+	switch (options.shape) {
+	case bench::graph_shape::chain:
+		for (size_t i = 0; i + 1 < count; i++)
+			dependencies[i].push_back(i + 1);
+		break;
+	case bench::graph_shape::fan_out:
+		for (size_t i = 0; i < count; i++) {
+			for (size_t j = fan_out * i + 1; j <= fan_out * i + fan_out && j < count; j++)
+				dependencies[i].push_back(j);
+		}
+		break;
+	case bench::graph_shape::diamond:
+		for (size_t i = 0; i < count; i++) {
+			size_t layer_start = i / fan_out * fan_out + fan_out;
+			for (size_t j = 0; j < (fan_out + 1) / 2; j++) {
+				size_t target = layer_start + (i + j) % fan_out;
+				if (target < count)
+					dependencies[i].push_back(target);
+			}
+		}
+		break;
+	default: {
+		// Each package gets one random dependant, so
+		// everything is reachable, then forward edges are added
+		std::mt19937 random(options.seed);
+		std::vector<std::set<size_t>> targets(count);
+		for (size_t i = 1; i < count; i++)
+			targets[std::uniform_int_distribution<size_t>(0, i - 1)(random)].insert(i);
+
+		for (size_t i = 0; i + 1 < count; i++) {
+			std::uniform_int_distribution<size_t> target(i + 1, count - 1);
+			size_t wanted = std::min(fan_out, count - i - 1);
+			while (targets[i].size() < wanted)
+				targets[i].insert(target(random));
+		}
+
+		for (size_t i = 0; i < count; i++)
+			dependencies[i].assign(targets[i].begin(), targets[i].end());
+	}
+	}
+
+	return dependencies;
+}
+
+namespace bench {
+
+graph generate_graph(const graph_options &options) {
+	if (options.package_count == 0 || options.version_count == 0)
+		throw std::invalid_argument("Graph needs at least one package and release.");
+
+	auto dependencies = get_dependencies(options);
+	bool overrides = options.shape == graph_shape::override;
+	std::string newest = get_version(options.version_count - 1);
+
+	graph result;
+	auto add_manifest = [&](const std::string &id, const std::vector<size_t> &targets) {
+		nl::json deps = nl::json::object();
+		for (size_t target : targets)
+			deps[get_id("bench", target)] = overrides ? newest : "^1.0";
+
+		nl::json manifest;
+		manifest["git"] = "https://example.com/" + id + ".git";
+		for (size_t i = 0; i < options.version_count; i++) {
+			auto &release = manifest["releases"][get_version(i)];
+			release["created"] = timestamp;
+			release["dependencies"] = deps;
+		}
+
+		result.manifests.emplace(id, std::move(manifest));
+		result.dependency_count += targets.size();
+	};
+
+	auto &root_deps = result.root_package["dependencies"];
+	result.root_package["id"] = "bench/root";
+	result.root_package["version"] = "1.0.0";
+	root_deps = nl::json::object();
+
+	// Diamonds start with a whole layer
+	size_t root_count = options.shape == graph_shape::diamond
+			? std::min(std::max<size_t>(options.fan_out, 1), options.package_count) : 1;
+	for (size_t i = 0; i < root_count; i++)
+		root_deps[get_id("bench", i)] = "^1.0";
+
+	for (size_t i = 0; i < options.package_count; i++) {
+		add_manifest(get_id("bench", i), dependencies[i]);
+		if (!overrides || i == 0 || i % 4 != 0)
+			continue;
+
+		// Older release or a fork with the same name replaces
+		// every release the rest of the graph asks for
+		if (i % 8 == 0) {
+			root_deps[get_id("bench", i)] = get_version(0);
+		} else {
+			root_deps[get_id("fork", i)] = newest;
+			add_manifest(get_id("fork", i), dependencies[i]);
+		}
+	}
+
+	result.dependency_count += root_deps.size();
+	return result;
+}
+
+std::string_view get_shape_name(graph_shape shape) {
+	switch (shape) {
+	case graph_shape::chain:
+		return "chain";
+	case graph_shape::fan_out:
+		return "fan-out";
+	case graph_shape::diamond:
+		return "diamond";
+	default:
+		return "override";
+	}
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace bench {
+
+enum class graph_shape {
+	// Each package depends on the next one
+	chain,
+	// Each package depends on "fan_out" packages that no other package needs
+	fan_out,
+	// Layers of "fan_out" packages, each depends on half of the next layer
+	diamond,
+	// Random forward dependencies on exact newest releases, while the root
+	// depends on older releases or forks of every fourth package
+	override
+};
+
+struct graph_options {
+	graph_shape shape = graph_shape::chain;
+	size_t package_count = 1000, fan_out = 8, version_count = 2;
+	uint32_t seed = 1;
+};
+
+// Manifests with the fields used for resolution, generated in memory
+struct graph {
+	nlohmann::json root_package;
+	std::unordered_map<std::string, nlohmann::json> manifests;
+	size_t dependency_count = 0;
+};
+
+graph generate_graph(const graph_options &options);
+
+std::string_view get_shape_name(graph_shape shape);
+
+}
@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "mock_archive.hpp"
+#include "registry.hpp"
+
+namespace fs = std::filesystem;
+namespace nl = nlohmann;
+
+struct options {
+	bench::registry_options registry;
+	std::chrono::milliseconds latency{ 0 };
+	size_t runs = 3;
+	std::optional<size_t> install_jobs;
+	bool tarballs = false;
+	fs::path volt_path = VOLT_BENCH_CLI_PATH;
+	fs::path work_path = fs::temp_directory_path() / "volt-bench";
+};
+
+struct scenario {
+	std::string name;
+	std::vector<std::string> args;
+	// Called before every run
+	std::function<void()> prepare;
+	// Concurrent CLI processes sharing VOLT_PATH, each with its own project
+	size_t processes = 1;
+};
+
+struct run_result {
+	std::chrono::microseconds wall_time;
+	long peak_rss_kib;
+	bool succeeded;
+};
+
+static void print_usage() {
+	std::cout << "Usage: volt-bench [options]\n"
+	             "  --packages {count}   Packages in the graph (default: 100).\n"
+	             "  --fan-out {count}    Dependencies per package (default: 3).\n"
+	             "  --versions {count}   Releases per package (default: 2).\n"
+	             "  --seed {number}      Seed of the graph generator (default: 1).\n"
+	             "  --ranges             Depend on version ranges instead of exact releases.\n"
+	             "  --conflicts {percent} Packages whose newest release conflicts\n"
+	             "                       with others, implies --ranges (default: 0).\n"
+	             "  --latency {ms}       Delay of every response (default: 0).\n"
+	             "  --runs {count}       Runs of every scenario (default: 3).\n"
+	             "  --jobs {count}       Parallel downloads of install.\n"
+	             "  --tarballs           Install from release archives instead of git.\n"
+	             "  --volt {path}        CLI executable to benchmark.\n"
+	             "  --work-dir {path}    Directory for generated files.\n";
+}
+
+static options parse_options(int argc, char **argv) {
+	options options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string_view name = argv[i];
+		if (name == "--help") {
+			print_usage();
+			std::exit(EXIT_SUCCESS);
+		}
+		if (name == "--tarballs") {
+			options.tarballs = true;
+			continue;
+		}
+		if (name == "--ranges") {
+			options.registry.ranges = true;
+			continue;
+		}
+
+		if (i + 1 == argc)
+			throw std::invalid_argument("Missing value of " + std::string(name) + '.');
+		std::string value = argv[++i];
+
+		if (name == "--packages")
+			options.registry.package_count = std::stoul(value);
+		else if (name == "--fan-out")
+			options.registry.fan_out = std::stoul(value);
+		else if (name == "--versions")
+			options.registry.version_count = std::stoul(value);
+		else if (name == "--seed")
+			options.registry.seed = std::stoul(value);
+		else if (name == "--conflicts")
+			options.registry.conflict_percent = std::stoul(value);
+		else if (name == "--latency")
+			options.latency = std::chrono::milliseconds(std::stoul(value));
+		else if (name == "--runs")
+			options.runs = std::max<size_t>(std::stoul(value), 1);
+		else if (name == "--jobs")
+			options.install_jobs = std::stoul(value);
+		else if (name == "--volt")
+			options.volt_path = value;
+		else if (name == "--work-dir")
+			options.work_path = value;
+		else
+			throw std::invalid_argument("Unknown option " + std::string(name) + '.');
+	}
+
+	options.volt_path = fs::absolute(options.volt_path);
+	options.work_path = fs::absolute(options.work_path);
+	return options;
+}
+
+// Starts CLI in "cwd" with output appended to "log_path"
+static pid_t spawn_volt(const options &options, const std::vector<std::string> &args,
+		const fs::path &cwd, const fs::path &log_path) {
+	std::vector<char *> argv;
+	std::string program = options.volt_path.string();
+	argv.push_back(program.data());
+	for (auto &arg : args)
+		argv.push_back(const_cast<char *>(arg.c_str()));
+	argv.push_back(nullptr);
+
+	pid_t pid = ::fork();
+	if (pid == -1)
+		throw std::system_error(errno, std::generic_category(), "Could not fork");
+
+	if (pid == 0) {
+		int log = ::open(log_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+		if (log == -1 || ::chdir(cwd.c_str()) == -1)
+			::_exit(127);
+
+		::dup2(log, STDOUT_FILENO);
+		::dup2(log, STDERR_FILENO);
+		::setenv("VOLT_PATH", (options.work_path / "volt").c_str(), 1);
+		::execv(argv.front(), argv.data());
+		::_exit(127);
+	}
+
+	return pid;
+}
+
+// Runs CLI once in each directory at the same time, wall time lasts
+// until the last one exits and peak RSS is the largest of the children
+static run_result run_volt(const options &options, const std::vector<std::string> &args,
+		const std::vector<fs::path> &cwds, const fs::path &log_path) {
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<pid_t> pids;
+	for (auto &cwd : cwds)
+		pids.push_back(spawn_volt(options, args, cwd, log_path));
+
+	run_result result{ {}, 0, true };
+	for (pid_t pid : pids) {
+		int status;
+		rusage usage;
+		if (::wait4(pid, &status, 0, &usage) == -1)
+			throw std::system_error(errno, std::generic_category(), "Could not wait for CLI");
+
+		result.peak_rss_kib = std::max(result.peak_rss_kib, usage.ru_maxrss);
+		result.succeeded &= WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+	}
+
+	result.wall_time = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start);
+	return result;
+}
+
+static void write_file(const fs::path &path, std::string_view data) {
+	fs::create_directories(path.parent_path());
+	std::ofstream stream(path, std::ofstream::binary);
+	stream.write(data.data(), data.size());
+}
+
+int main(int argc, char **argv) {
+	try {
+		options options = parse_options(argc, argv);
+
+		if (!fs::exists(options.volt_path))
+			throw std::runtime_error("No CLI executable at " + options.volt_path.string() + '.');
+
+		fs::remove_all(options.work_path);
+		fs::path volt_path = options.work_path / "volt";
+		fs::path project_path = options.work_path / "project";
+		fs::path log_path = options.work_path / "logs";
+		fs::create_directories(project_path / "cache");
+		fs::create_directories(log_path);
+
+		std::cout << "Generating " << options.registry.package_count
+		          << " packages with " << options.registry.version_count
+		          << " releases each...\n" << std::flush;
+
+		bench::mock_archive archive(options.latency);
+		if (options.tarballs)
+			options.registry.archive_url = archive.get_url();
+
+		auto generation_start = std::chrono::steady_clock::now();
+		bench::registry registry(options.work_path, options.registry);
+		auto generation_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - generation_start);
+		archive.serve(registry);
+
+		// Every cached response is revalidated, so warm runs still
+		// measure the round trips rather than only reading files
+		nl::json config;
+		config["archives"][archive.get_url()] = "";
+		config["color"] = "cyan";
+		config["httpCache"]["ttl"] = 0;
+		if (options.install_jobs)
+			config["installJobs"] = *options.install_jobs;
+		write_file(volt_path / "config.json", config.dump(1, '\t'));
+		write_file(project_path / "package.json",
+				registry.get_root_package().dump(1, '\t'));
+
+		std::cout << "Generated in " << generation_time.count() << " ms: "
+		          << registry.get_dependency_count() << " dependency edges, "
+		          << registry.get_tree_size() << " tree nodes, archive at "
+		          << archive.get_url() << " with " << options.latency.count()
+		          << " ms latency.\n\n";
+
+		auto clear_packages = [&]() {
+			fs::remove_all(volt_path / "packages");
+			fs::remove_all(volt_path / "store");
+		};
+
+		// Each project resolves again instead of using its lockfile
+		auto clear_lockfiles = [&]() {
+			for (auto &entry : fs::directory_iterator(options.work_path)) {
+				if (entry.path().filename().string().starts_with("project"))
+					fs::remove(entry.path() / "package-lock.json");
+			}
+		};
+
+		auto clear_caches = [&]() {
+			clear_packages();
+			clear_lockfiles();
+			fs::remove_all(volt_path / "cache");
+			fs::remove_all(volt_path / "mirrors");
+		};
+
+		std::vector<scenario> scenarios = {
+			{ "top (cold)", { "top" }, clear_caches },
+			{ "top (warm)", { "top" }, {} },
+			{ "search (cold)", { "search", "package-1" }, clear_caches },
+			{ "info (cold)", { "info", registry.get_ids().front() }, clear_caches },
+			{ "install (cold)", { "install" }, clear_caches },
+			{ "fetch (cold)", { "fetch" }, clear_caches },
+			{ "install (fetched)", { "install" }, clear_lockfiles },
+			{ "install (warm)", { "install" }, clear_lockfiles },
+			{ "install (locked)", { "install" }, {} },
+			{ "install (mirrored)", { "install" }, clear_packages },
+			{ "install (4 shared)", { "install" }, clear_caches, 4 }
+		};
+
+		std::cout << std::left << std::setw(20) << "Scenario" << std::right
+		          << std::setw(12) << "Median ms" << std::setw(10) << "Min ms"
+		          << std::setw(10) << "Requests" << std::setw(7) << "304s"
+		          << std::setw(13) << "Connections" << std::setw(15) << "Peak RSS KiB"
+		          << '\n';
+
+		bool failed = false;
+		for (auto &scenario : scenarios) {
+			// Like CI jobs that check out the same project and share a cache
+			std::vector<fs::path> cwds{ project_path };
+			for (size_t i = 1; i < scenario.processes; i++) {
+				fs::path path = options.work_path / ("project-" + std::to_string(i));
+				fs::create_directories(path / "cache");
+				fs::copy_file(project_path / "package.json", path / "package.json",
+						fs::copy_options::overwrite_existing);
+				cwds.push_back(std::move(path));
+			}
+
+			std::vector<std::chrono::microseconds> wall_times;
+			long peak_rss_kib = 0;
+			auto before = archive.get_stats();
+			bool succeeded = true;
+
+			for (size_t i = 0; i < options.runs; i++) {
+				if (scenario.prepare)
+					scenario.prepare();
+
+				auto result = run_volt(options, scenario.args, cwds,
+						log_path / (scenario.args.front() + ".txt"));
+				wall_times.push_back(result.wall_time);
+				peak_rss_kib = std::max(peak_rss_kib, result.peak_rss_kib);
+				succeeded &= result.succeeded;
+			}
+
+			auto after = archive.get_stats();
+			std::sort(wall_times.begin(), wall_times.end());
+			auto ms = [](std::chrono::microseconds time) {
+				return time.count() / 1000.0;
+			};
+
+			std::cout << std::left << std::setw(20) << scenario.name << std::right
+			          << std::fixed << std::setprecision(1)
+			          << std::setw(12) << ms(wall_times[wall_times.size() / 2])
+			          << std::setw(10) << ms(wall_times.front())
+			          << std::setw(10) << (after.requests - before.requests) / options.runs
+			          << std::setw(7) << (after.not_modified - before.not_modified) / options.runs
+			          << std::setw(13) << (after.connections - before.connections) / options.runs
+			          << std::setw(15) << peak_rss_kib
+			          << (succeeded ? "" : "  (failed)") << '\n' << std::flush;
+			failed |= !succeeded;
+		}
+
+		std::cout << "\nRequests, 304s and connections are per run. CLI output is in "
+		          << log_path.string() << ".\n";
+		return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+}
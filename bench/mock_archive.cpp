@@ -0,0 +1,285 @@
+#include "mock_archive.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static std::system_error socket_error(const char *what) {
+	return std::system_error(errno, std::generic_category(), what);
+}
+
+static bool equals_ignore_case(std::string_view a, std::string_view b) {
+	return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](char a, char b) {
+		return std::tolower(static_cast<unsigned char>(a))
+				== std::tolower(static_cast<unsigned char>(b));
+	});
+}
+
+static std::string decode_url(std::string_view str) {
+	std::string result;
+	result.reserve(str.size());
+
+	for (size_t i = 0; i < str.size(); i++) {
+		if (str[i] == '%' && i + 2 < str.size()) {
+			result.push_back(static_cast<char>(std::stoi(
+					std::string(str.substr(i + 1, 2)), nullptr, 16)));
+			i += 2;
+		} else
+			result.push_back(str[i] == '+' ? ' ' : str[i]);
+	}
+
+	return result;
+}
+
+static std::string get_etag(std::string_view body) {
+	// 64-bit FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : body) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ull;
+	}
+
+	std::stringstream ss;
+	ss << '"' << std::hex << std::setw(16) << std::setfill('0') << hash << '"';
+	return ss.str();
+}
+
+static void send_all(int socket, std::string_view data) {
+	while (!data.empty()) {
+		ssize_t sent = ::send(socket, data.data(), data.size(), MSG_NOSIGNAL);
+		if (sent <= 0)
+			return;
+
+		data.remove_prefix(sent);
+	}
+}
+
+namespace bench {
+
+mock_archive::mock_archive(std::chrono::milliseconds latency) : latency(latency) {
+	listen_socket = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (listen_socket == -1)
+		throw socket_error("Could not create socket");
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+
+	socklen_t address_size = sizeof(address);
+	if (::bind(listen_socket, reinterpret_cast<sockaddr *>(&address), address_size) == -1
+			|| ::listen(listen_socket, SOMAXCONN) == -1
+			|| ::getsockname(listen_socket, reinterpret_cast<sockaddr *>(&address), &address_size) == -1) {
+		auto error = socket_error("Could not listen on loopback");
+		::close(listen_socket);
+		throw error;
+	}
+
+	port = ntohs(address.sin_port);
+	acceptor = std::thread(&mock_archive::accept_connections, this);
+}
+
+mock_archive::~mock_archive() {
+	stopping = true;
+	::shutdown(listen_socket, SHUT_RDWR);
+	acceptor.join();
+	::close(listen_socket);
+
+	{
+		std::lock_guard lock(mutex);
+		for (int socket : client_sockets)
+			::shutdown(socket, SHUT_RDWR);
+	}
+
+	for (auto &worker : workers)
+		worker.join();
+}
+
+std::string mock_archive::get_url() const {
+	return "http://127.0.0.1:" + std::to_string(port) + '/';
+}
+
+mock_archive::stats mock_archive::get_stats() const noexcept {
+	stats stats;
+	stats.requests = requests;
+	stats.connections = connections;
+	stats.not_modified = not_modified;
+	return stats;
+}
+
+void mock_archive::serve(const registry &registry) noexcept {
+	archive_registry = &registry;
+}
+
+void mock_archive::accept_connections() {
+	while (true) {
+		int socket = ::accept(listen_socket, nullptr, nullptr);
+		if (socket == -1) {
+			if (stopping)
+				return;
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			return;
+		}
+
+		int enable = 1;
+		::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+		connections++;
+
+		std::lock_guard lock(mutex);
+		client_sockets.push_back(socket);
+		workers.emplace_back(&mock_archive::serve_connection, this, socket);
+	}
+}
+
+void mock_archive::serve_connection(int socket) {
+	std::string buffer;
+	char chunk[4096];
+
+	auto receive = [&]() {
+		ssize_t received = ::recv(socket, chunk, sizeof(chunk), 0);
+		if (received <= 0)
+			return false;
+
+		buffer.append(chunk, received);
+		return true;
+	};
+
+	bool open = true;
+	while (open) {
+		size_t header_end;
+		while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos && open)
+			open = receive();
+		if (!open)
+			break;
+
+		std::string_view head(buffer.data(), header_end);
+		request request;
+
+		size_t line_end = head.find("\r\n");
+		std::string_view request_line = head.substr(0, line_end);
+		size_t target_start = request_line.find(' ') + 1;
+		size_t target_end = request_line.find(' ', target_start);
+		request.method = request_line.substr(0, target_start - 1);
+		request.target = request_line.substr(target_start, target_end - target_start);
+
+		while (line_end != std::string_view::npos) {
+			size_t line_start = line_end + 2;
+			line_end = head.find("\r\n", line_start);
+			std::string_view line = head.substr(line_start, line_end - line_start);
+
+			size_t colon = line.find(':');
+			if (colon == std::string_view::npos)
+				continue;
+
+			std::string_view name = line.substr(0, colon);
+			std::string_view value = line.substr(colon + 1);
+			while (!value.empty() && value.front() == ' ')
+				value.remove_prefix(1);
+
+			if (equals_ignore_case(name, "If-None-Match"))
+				request.if_none_match = value;
+			else if (equals_ignore_case(name, "Content-Length"))
+				request.content_length = std::stoul(std::string(value));
+			else if (equals_ignore_case(name, "Connection"))
+				request.keep_alive = !equals_ignore_case(value, "close");
+		}
+
+		buffer.erase(0, header_end + 4);
+		while (buffer.size() < request.content_length && open)
+			open = receive();
+		if (!open)
+			break;
+		buffer.erase(0, request.content_length);
+
+		requests++;
+		if (latency.count() != 0)
+			std::this_thread::sleep_for(latency);
+
+		send_all(socket, respond(request));
+		open = request.keep_alive;
+	}
+
+	{
+		std::lock_guard lock(mutex);
+		client_sockets.erase(std::find(
+				client_sockets.begin(), client_sockets.end(), socket));
+	}
+	::close(socket);
+}
+
+std::string mock_archive::respond(const request &request) {
+	std::string_view target = request.target;
+	std::string_view path = target.substr(0, target.find('?'));
+	std::string_view query = path.size() < target.size()
+			? target.substr(path.size() + 1) : std::string_view();
+
+	int32_t status = 200;
+	std::string body, content_type = "application/json";
+	const registry *registry = archive_registry;
+
+	static constexpr std::string_view package_prefix = "/package/";
+	static constexpr std::string_view tarball_prefix = "/tarball/";
+	if (request.method != "GET")
+		status = 405;
+	else if (!registry)
+		status = 404;
+	else if (path == "/top/")
+		body = registry->get_top();
+	else if (path == "/search" || path == "/search/") {
+		std::string_view keywords;
+		if (query.starts_with("query="))
+			keywords = query.substr(6, query.find('&') - 6);
+		body = registry->search(decode_url(keywords));
+	} else if (path.starts_with(package_prefix)) {
+		std::string_view id = path.substr(package_prefix.size());
+		if (id.ends_with('/'))
+			id.remove_suffix(1);
+
+		if (auto manifest = registry->find_manifest(id))
+			body = *manifest;
+		else
+			status = 404;
+	} else if (path.starts_with(tarball_prefix)) {
+		if (auto tarball = registry->find_tarball(path.substr(tarball_prefix.size()))) {
+			body = *tarball;
+			content_type = "application/gzip";
+		} else
+			status = 404;
+	} else
+		status = 404;
+
+	std::string connection = request.keep_alive ? "keep-alive" : "close";
+	if (status != 200) {
+		body = status == 404 ? "Not found." : "Method not allowed.";
+		return "HTTP/1.1 " + std::to_string(status)
+				+ (status == 404 ? " Not Found" : " Method Not Allowed")
+				+ "\r\nContent-Type: text/plain\r\nContent-Length: "
+				+ std::to_string(body.size()) + "\r\nConnection: "
+				+ connection + "\r\n\r\n" + body;
+	}
+
+	std::string etag = get_etag(body);
+	if (request.if_none_match == etag) {
+		not_modified++;
+		return "HTTP/1.1 304 Not Modified\r\nETag: " + etag
+				+ "\r\nContent-Length: 0\r\nConnection: "
+				+ connection + "\r\n\r\n";
+	}
+
+	return "HTTP/1.1 200 OK\r\nContent-Type: " + content_type + "\r\nETag: " + etag
+			+ "\r\nContent-Length: " + std::to_string(body.size())
+			+ "\r\nConnection: " + connection + "\r\n\r\n" + body;
+}
+
+}
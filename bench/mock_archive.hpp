@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "registry.hpp"
+
+namespace bench {
+
+// Archive API served over HTTP/1.1 on a loopback port chosen
+// by the system. Every connection is served by its own thread
+// and every response is delayed by the injected latency.
+class mock_archive {
+public:
+	struct stats {
+		uint32_t requests = 0, connections = 0, not_modified = 0;
+	};
+
+	// Starts listening, so URL is known before registry is generated
+	mock_archive(std::chrono::milliseconds latency);
+
+	mock_archive(const mock_archive &other) = delete;
+
+	~mock_archive();
+
+	// Ends with '/' like archive URLs in "config.json"
+	std::string get_url() const;
+
+	stats get_stats() const noexcept;
+
+	// Registry must outlive the archive
+	void serve(const registry &registry) noexcept;
+
+private:
+	struct request {
+		std::string method, target, if_none_match;
+		size_t content_length = 0;
+		bool keep_alive = true;
+	};
+
+	std::atomic<const registry *> archive_registry = nullptr;
+	std::chrono::milliseconds latency;
+
+	int listen_socket;
+	uint16_t port;
+	std::atomic<bool> stopping = false;
+	std::atomic<uint32_t> requests = 0, connections = 0, not_modified = 0;
+
+	std::thread acceptor;
+	std::mutex mutex;
+	std::vector<int> client_sockets;
+	std::vector<std::thread> workers;
+
+	void accept_connections();
+
+	void serve_connection(int socket);
+
+	std::string respond(const request &request);
+};
+
+}
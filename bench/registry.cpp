@@ -0,0 +1,206 @@
+#include "registry.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+namespace nl = nlohmann;
+
+static const std::string scope = "bench";
+static const std::string timestamp = "2022-01-01T00:00:00.000Z";
+
+static std::string get_version(size_t index) {
+	return "1." + std::to_string(index) + ".0";
+}
+
+static void write_file(const fs::path &path, std::string_view data) {
+	fs::create_directories(path.parent_path());
+	std::ofstream stream(path, std::ofstream::binary);
+	stream.write(data.data(), data.size());
+}
+
+static void run_git(const fs::path &repo_path, const std::string &args) {
+	std::string cmd = "git -C \"" + repo_path.string() + "\" -c user.name=bench"
+			" -c user.email=bench@localhost " + args + " >/dev/null 2>&1";
+
+	if (std::system(cmd.c_str()) != 0)
+		throw std::runtime_error("Command failed: " + cmd);
+}
+
+namespace bench {
+
+registry::registry(const fs::path &path, const registry_options &options) {
+	if (options.package_count == 0 || options.version_count == 0)
+		throw std::invalid_argument("Registry needs at least one package and release.");
+
+	size_t root_count = std::clamp<size_t>(options.fan_out, 1, options.package_count);
+
+	// Each package outside of roots gets one random dependant,
+	// so everything is reachable, then forward edges are added
+	std::mt19937 random(options.seed);
+	std::vector<std::set<size_t>> dependencies(options.package_count);
+
+	for (size_t i = root_count; i < options.package_count; i++)
+		dependencies[std::uniform_int_distribution<size_t>(0, i - 1)(random)].insert(i);
+
+	for (size_t i = 0; i + 1 < options.package_count; i++) {
+		std::uniform_int_distribution<size_t> target(i + 1, options.package_count - 1);
+		size_t wanted = std::min(options.fan_out, options.package_count - i - 1);
+
+		while (dependencies[i].size() < wanted)
+			dependencies[i].insert(target(random));
+	}
+
+	ids.reserve(options.package_count);
+	for (size_t i = 0; i < options.package_count; i++)
+		ids.push_back(scope + "/package-" + std::to_string(i));
+
+	std::vector<bool> conflicting(options.package_count);
+	for (size_t i = 0; i < options.package_count; i++)
+		conflicting[i] = std::uniform_int_distribution<size_t>(0, 99)(random) < options.conflict_percent;
+
+	bool ranges = options.ranges || options.conflict_percent != 0;
+	std::string latest = get_version(options.version_count - 1);
+
+	auto get_range = [&](size_t package, size_t release) {
+		if (!ranges)
+			return latest;
+		if (release + 1 < options.version_count)
+			return std::string("^1.0");
+		return (conflicting[package] ? "<" : "^") + latest;
+	};
+
+	fs::path repos_path = path / "repos";
+	for (size_t i = 0; i < options.package_count; i++) {
+		dependency_count += dependencies[i].size();
+
+		std::string name = ids[i].substr(scope.size() + 1);
+		fs::path repo_path = repos_path / name;
+		fs::remove_all(repo_path);
+		fs::create_directories(repo_path);
+		run_git(repo_path, "init -q");
+
+		// Releases of a package share the payload, packages don't
+		std::string payload;
+		for (size_t j = 0; j < 256; j++)
+			payload += "// Line " + std::to_string(j) + " of " + name + " payload.\n";
+
+		nl::json manifest;
+		manifest["id"] = ids[i];
+		manifest["description"] = "Synthetic package number " + std::to_string(i) + '.';
+		manifest["license"] = "MIT";
+		manifest["keywords"] = { "bench", name };
+		manifest["git"] = "file://" + fs::absolute(repo_path).generic_string();
+		manifest["created"] = timestamp;
+		manifest["modified"] = timestamp;
+		manifest["views"] = nl::json::object();
+
+		for (size_t j = 0; j < options.version_count; j++) {
+			std::string version = get_version(j);
+
+			nl::json deps = nl::json::object();
+			for (size_t dep : dependencies[i])
+				deps[ids[dep]] = get_range(i, j);
+
+			nl::json package;
+			package["id"] = ids[i];
+			package["version"] = version;
+			package["dependencies"] = deps;
+			write_file(repo_path / "package.json", package.dump(1, '\t'));
+			write_file(repo_path / "include" / (name + ".hpp"), payload);
+
+			run_git(repo_path, "add -A");
+			run_git(repo_path, "commit -q -m " + version);
+			run_git(repo_path, "tag " + version);
+
+			manifest["releases"][version]["created"] = timestamp;
+			manifest["releases"][version]["dependencies"] = deps;
+
+			if (!options.archive_url.empty()) {
+				std::string file_name = name + '-' + version + ".tar.gz";
+				fs::path tarball_path = fs::absolute(path / "tarballs" / file_name);
+				fs::create_directories(tarball_path.parent_path());
+				run_git(repo_path, "archive --format=tar.gz -o \""
+						+ tarball_path.string() + "\" " + version);
+
+				std::ifstream stream(tarball_path, std::ifstream::binary);
+				tarballs.emplace(file_name, std::string(
+						std::istreambuf_iterator<char>(stream), {}));
+				manifest["releases"][version]["tarball"]
+						= options.archive_url + "tarball/" + file_name;
+			}
+		}
+
+		manifests.emplace(ids[i], manifest.dump());
+	}
+
+	// Dependencies come later, so their subtrees are counted first
+	std::vector<size_t> subtree_sizes(options.package_count);
+	for (size_t i = options.package_count; i-- > 0;) {
+		size_t size = 1;
+		for (size_t dep : dependencies[i])
+			size = std::min(size + subtree_sizes[dep], SIZE_MAX / 2);
+		subtree_sizes[i] = size;
+	}
+
+	for (size_t i = 0; i < root_count; i++)
+		tree_size = std::min(tree_size + subtree_sizes[i], SIZE_MAX / 2);
+
+	root_package["id"] = scope + "/root";
+	root_package["version"] = "0.1.0";
+	root_package["dependencies"] = nl::json::object();
+	for (size_t i = 0; i < root_count; i++)
+		root_package["dependencies"][ids[i]] = ranges ? "^1.0" : latest;
+}
+
+const std::string *registry::find_manifest(std::string_view id) const {
+	auto it = manifests.find(id);
+	return it == manifests.end() ? nullptr : &it->second;
+}
+
+const std::string *registry::find_tarball(std::string_view file_name) const {
+	auto it = tarballs.find(file_name);
+	return it == tarballs.end() ? nullptr : &it->second;
+}
+
+std::string registry::search(std::string_view query) const {
+	nl::json results = nl::json::array();
+	for (auto &id : ids) {
+		if (id.find(query) != std::string::npos)
+			results.push_back(id);
+	}
+
+	return results.dump();
+}
+
+std::string registry::get_top() const {
+	nl::json results = nl::json::array();
+	for (size_t i = 0; i < std::min<size_t>(ids.size(), 20); i++)
+		results.push_back(ids[i]);
+
+	return results.dump();
+}
+
+const nl::json &registry::get_root_package() const noexcept {
+	return root_package;
+}
+
+const std::vector<std::string> &registry::get_ids() const noexcept {
+	return ids;
+}
+
+size_t registry::get_dependency_count() const noexcept {
+	return dependency_count;
+}
+
+size_t registry::get_tree_size() const noexcept {
+	return tree_size;
+}
+
+}
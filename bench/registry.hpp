@@ -0,0 +1,63 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace bench {
+
+struct registry_options {
+	// Every package depends on roughly "fan_out" packages
+	// that come after it, so the graph has no cycles
+	size_t package_count = 100, fan_out = 3, version_count = 2;
+	uint32_t seed = 1;
+	// Dependencies are ranges. Newest releases need the newest release
+	// of each dependency, older ones accept any release.
+	bool ranges = false;
+	// Share of packages whose newest release needs older releases of its
+	// dependencies instead, so solving has to backtrack. Implies ranges.
+	size_t conflict_percent = 0;
+	// If set, releases also come as "{archive_url}tarball/{name}-{version}.tar.gz"
+	std::string archive_url;
+};
+
+// Synthetic archive contents. Each package gets a manifest
+// and a git repository with a tag for each of its releases.
+class registry {
+public:
+	registry(const std::filesystem::path &path, const registry_options &options);
+
+	// Serialized manifest or nullptr if there is no such package
+	const std::string *find_manifest(std::string_view id) const;
+
+	// Contents of "{name}-{version}.tar.gz" or nullptr
+	const std::string *find_tarball(std::string_view file_name) const;
+
+	// JSON array of IDs containing the query
+	std::string search(std::string_view query) const;
+
+	// JSON array of IDs shown by "volt top"
+	std::string get_top() const;
+
+	// "package.json" which depends on the roots of the graph
+	const nlohmann::json &get_root_package() const noexcept;
+
+	const std::vector<std::string> &get_ids() const noexcept;
+
+	size_t get_dependency_count() const noexcept;
+
+	// Nodes of the dependency tree before flattening, one per path from the root
+	size_t get_tree_size() const noexcept;
+
+private:
+	std::vector<std::string> ids;
+	std::map<std::string, std::string, std::less<>> manifests, tarballs;
+	nlohmann::json root_package;
+	size_t dependency_count = 0, tree_size = 0;
+};
+
+}
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+#include "graphs.hpp"
+#include "resolver.hpp"
+
+namespace nl = nlohmann;
+
+// Every allocation of the process is counted, phases
+// read the difference before and after them
+static std::atomic<size_t> allocation_count{ 0 }, allocated_bytes{ 0 };
+
+// Once inlined, GCC pairs malloc and free below with new and delete
+// of callers and reports them as mismatched
+#if defined(__GNUC__) || defined(__clang__)
+#define VOLT_BENCH_ALLOCATOR [[gnu::noinline]]
+#else
+#define VOLT_BENCH_ALLOCATOR
+#endif
+
+VOLT_BENCH_ALLOCATOR void *operator new(std::size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+
+	if (void *pointer = std::malloc(size == 0 ? 1 : size))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+VOLT_BENCH_ALLOCATOR void operator delete(void *pointer) noexcept {
+	std::free(pointer);
+}
+
+VOLT_BENCH_ALLOCATOR void operator delete(void *pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+struct options {
+	bench::graph_options graph;
+	std::vector<bench::graph_shape> shapes{
+		bench::graph_shape::chain, bench::graph_shape::fan_out,
+		bench::graph_shape::diamond, bench::graph_shape::override
+	};
+	size_t runs = 5;
+};
+
+// Manifests of the generated graph, nothing is printed or downloaded
+class memory_source : public resolver::manifest_provider {
+public:
+	memory_source(const std::unordered_map<std::string, nl::json> &manifests)
+			: manifests(manifests) {}
+
+	std::vector<const nl::json *> load(const std::vector<solver::request> &requests) override {
+		std::vector<const nl::json *> result;
+		for (auto &request : requests) {
+			auto it = manifests.find(std::string(request.id));
+			result.push_back(it == manifests.end() ? nullptr : &it->second);
+		}
+		return result;
+	}
+
+	const nl::json &get_manifest(const std::string &id) override {
+		return manifests.at(id);
+	}
+
+private:
+	const std::unordered_map<std::string, nl::json> &manifests;
+};
+
+struct phase_result {
+	std::chrono::microseconds time;
+	size_t allocation_count, allocated_bytes;
+};
+
+static phase_result measure(const std::function<void()> &phase) {
+	size_t count = allocation_count, bytes = allocated_bytes;
+	auto start = std::chrono::steady_clock::now();
+	phase();
+
+	return {
+		std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - start),
+		allocation_count - count, allocated_bytes - bytes
+	};
+}
+
+static void print_usage() {
+	std::cout << "Usage: volt-resolver-bench [options]\n"
+	             "  --packages {count}   Packages in each graph (default: 1000).\n"
+	             "  --fan-out {count}    Dependencies per package, layer width\n"
+	             "                       of diamonds (default: 8).\n"
+	             "  --versions {count}   Releases per package (default: 2).\n"
+	             "  --seed {number}      Seed of the graph generator (default: 1).\n"
+	             "  --shape {name}       Only chain, fan-out, diamond or override.\n"
+	             "  --runs {count}       Runs of every graph (default: 5).\n";
+}
+
+static options parse_options(int argc, char **argv) {
+	options options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string_view name = argv[i];
+		if (name == "--help") {
+			print_usage();
+			std::exit(EXIT_SUCCESS);
+		}
+
+		if (i + 1 == argc)
+			throw std::invalid_argument("Missing value of " + std::string(name) + '.');
+		std::string value = argv[++i];
+
+		if (name == "--packages") {
+			options.graph.package_count = std::stoul(value);
+		} else if (name == "--fan-out") {
+			options.graph.fan_out = std::stoul(value);
+		} else if (name == "--versions") {
+			options.graph.version_count = std::stoul(value);
+		} else if (name == "--seed") {
+			options.graph.seed = std::stoul(value);
+		} else if (name == "--runs") {
+			options.runs = std::max<size_t>(std::stoul(value), 1);
+		} else if (name == "--shape") {
+			auto shape = std::find_if(options.shapes.begin(), options.shapes.end(),
+					[&value](auto shape) { return bench::get_shape_name(shape) == value; });
+			if (shape == options.shapes.end())
+				throw std::invalid_argument("Unknown shape " + value + '.');
+			options.shapes = { *shape };
+		} else
+			throw std::invalid_argument("Unknown option " + std::string(name) + '.');
+	}
+
+	return options;
+}
+
+int main(int argc, char **argv) {
+	try {
+		options options = parse_options(argc, argv);
+
+		std::cout << std::left << std::setw(10) << "Graph" << std::setw(10) << "Phase"
+		          << std::right << std::setw(12) << "Median ms" << std::setw(10) << "Min ms"
+		          << std::setw(13) << "Allocations" << std::setw(13) << "Alloc KiB"
+		          << '\n';
+
+		for (auto shape : options.shapes) {
+			options.graph.shape = shape;
+			auto graph = bench::generate_graph(options.graph);
+
+			static constexpr std::string_view phase_names[]{
+				"solve", "tree", "depths", "flatten"
+			};
+			std::vector<std::vector<phase_result>> results(std::size(phase_names));
+			size_t tree_size = 0, warning_count = 0;
+
+			for (size_t run = 0; run < options.runs; run++) {
+				memory_source source(graph.manifests);
+				solver::solution solution;
+				resolver::dependency_tree tree;
+				std::vector<uint32_t> depths;
+				resolver::resolution resolution;
+
+				results[0].push_back(measure([&]() {
+					solution = solver::solve(graph.root_package, source);
+				}));
+				results[1].push_back(measure([&]() {
+					tree = resolver::build_tree(graph.root_package, solution, source);
+				}));
+				results[2].push_back(measure([&]() {
+					depths = resolver::compute_depths(graph.root_package, tree, source);
+				}));
+				tree_size = tree.graph.size();
+				results[3].push_back(measure([&]() {
+					resolution = resolver::flatten(std::move(tree), depths);
+				}));
+				warning_count = resolution.warning_count;
+			}
+
+			for (size_t i = 0; i < results.size(); i++) {
+				auto &phase = results[i];
+				std::sort(phase.begin(), phase.end(), [](auto &a, auto &b) {
+					return a.time < b.time;
+				});
+
+				auto ms = [](std::chrono::microseconds time) {
+					return time.count() / 1000.0;
+				};
+
+				std::cout << std::left << std::setw(10) << (i == 0
+						? std::string(bench::get_shape_name(shape)) : "")
+				          << std::setw(10) << phase_names[i] << std::right
+				          << std::fixed << std::setprecision(2)
+				          << std::setw(12) << ms(phase[phase.size() / 2].time)
+				          << std::setw(10) << ms(phase.front().time)
+				          << std::setw(13) << phase.front().allocation_count
+				          << std::setw(13) << phase.front().allocated_bytes / 1024
+				          << '\n';
+			}
+
+			std::cout << std::setw(20) << "" << graph.manifests.size() << " packages, "
+			          << graph.dependency_count << " dependencies, " << tree_size - 1
+			          << " selected, " << warning_count << " warnings\n" << std::flush;
+		}
+
+		return EXIT_SUCCESS;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+}
@@ -9,8 +9,10 @@ class ConanFile(ConanFile):
 		# and cause template parameter deduction errors with date::parse / date::parse
 		# Temporarily falling back to local installation
 		'libcurl/7.80.0',
+		'libgit2/1.7.1',
 		'nlohmann_json/3.9.1',
-		'termcolor/2.0.0'
+		'termcolor/2.0.0',
+		'zlib/1.2.11'
 	]
 	generators = 'cmake_find_package'
 
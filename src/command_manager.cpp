@@ -9,6 +9,7 @@ void command_manager::init() {
 	commands["build"] = std::make_shared<build_command>();
 	commands["debug"] = std::make_shared<debug_command>();
 	commands["edit"] = std::make_shared<edit_command>();
+	commands["fetch"] = std::make_shared<fetch_command>();
 	commands["help"] = std::make_shared<help_command>();
 	commands["info"] = std::make_shared<info_command>();
 	commands["init"] = std::make_shared<init_command>();
@@ -19,6 +20,7 @@ void command_manager::init() {
 	commands["top"] = std::make_shared<top_command>();
 	commands["uninstall"] = std::make_shared<uninstall_command>();
 	commands["unpublish"] = std::make_shared<unpublish_command>();
+	commands["verify"] = std::make_shared<verify_command>();
 }
 
 const std::map<std::string, std::shared_ptr<
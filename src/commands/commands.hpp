@@ -18,6 +18,7 @@ DECLARE_COMMAND(auth_command);
 DECLARE_COMMAND(build_command);
 DECLARE_COMMAND(debug_command);
 DECLARE_COMMAND(edit_command);
+DECLARE_COMMAND(fetch_command);
 DECLARE_COMMAND(help_command);
 DECLARE_COMMAND(info_command);
 DECLARE_COMMAND(init_command);
@@ -28,6 +29,7 @@ DECLARE_COMMAND(search_command);
 DECLARE_COMMAND(top_command);
 DECLARE_COMMAND(uninstall_command);
 DECLARE_COMMAND(unpublish_command);
+DECLARE_COMMAND(verify_command);
 
 }
 
@@ -0,0 +1,80 @@
+#include "commands.hpp"
+
+#include "util/file.hpp"
+#include "colors.hpp"
+#include "downloader.hpp"
+#include "lockfile.hpp"
+#include "resolver.hpp"
+
+namespace fs = std::filesystem;
+namespace tc = termcolor;
+namespace nl = nlohmann;
+
+namespace commands {
+
+fetch_command::fetch_command() : command(
+		"fetch",
+		"[--jobs {count}] [{package.json path}...]",
+		"Downloads dependencies of each \"package.json\" into \"VOLT_PATH\"\n"
+		"without writing any files of the project, e.g. to warm up a shared\n"
+		"cache. Defaults to \"package.json\" in current directory.") {}
+
+void fetch_command::run(const std::vector<std::string> &arguments) const {
+	std::vector<std::string> args = arguments;
+	size_t job_count = downloader::take_job_count(args);
+
+	std::vector<fs::path> package_paths(args.begin(), args.end());
+	if (package_paths.empty())
+		package_paths.push_back(fs::current_path() / "package.json");
+
+	// Jobs point to nodes owned by resolutions, which stay in place when they're moved
+	std::vector<resolver::resolution> resolutions;
+	resolutions.reserve(package_paths.size());
+
+	std::vector<downloader::download_job> jobs;
+	std::set<fs::path> package_versions, job_paths;
+
+	for (auto &package_path : package_paths) {
+		if (!fs::exists(package_path))
+			throw std::runtime_error("No such file: " + package_path.string());
+
+		std::string package_contents = util::read_file(package_path);
+		nl::json package = nl::json::parse(package_contents);
+		std::cout << "\nResolving " << package_path.string() << ":\n";
+		if (!package.contains("dependencies") || package["dependencies"].empty()) {
+			std::cout << "Package has no dependencies.\n";
+			continue;
+		}
+
+		auto locked = lockfile::read(lockfile::get_path(package_path),
+				lockfile::get_inputs_hash(package_contents), package);
+		if (locked)
+			std::cout << "Dependency tree is locked by \"package-lock.json\".\n";
+
+		auto &resolution = resolutions.emplace_back(
+				locked ? std::move(*locked) : resolver::resolve(package));
+		for (resolver::node_index node : resolution.packages)
+			package_versions.insert(downloader::get_package_path(resolution.graph[node]));
+
+		// Packages shared by several projects are downloaded once
+		for (auto &job : downloader::get_jobs(resolution)) {
+			if (job_paths.insert(job.path).second)
+				jobs.push_back(std::move(job));
+		}
+	}
+
+	size_t failed_count = downloader::download(jobs, job_count);
+	if (failed_count != 0) {
+		throw std::runtime_error(std::to_string(failed_count)
+				+ (failed_count == 1 ? " package" : " packages")
+				+ " failed to download.");
+	}
+
+	size_t present_count = package_versions.size() - jobs.size();
+	std::cout << colors::success << "\nDownloaded " << jobs.size()
+	          << (jobs.size() == 1 ? " package, " : " packages, ") << present_count
+	          << (present_count == 1 ? " was" : " were") << " already present.\n"
+	          << tc::reset;
+}
+
+}
@@ -1,7 +1,9 @@
 #include "commands.hpp"
 
 #include "util/file.hpp"
+#include "util/git.hpp"
 #include "util/http.hpp"
+#include "util/http_cache.hpp"
 #include "colors.hpp"
 #include "common.hpp"
 
@@ -37,33 +39,12 @@ void publish_command::run(const std::vector<std::string> &args) const {
 	std::cout << "Checking Git tag...";
 
 	try {
-		std::string line;
-		bool tag_exists = false;
-		util::shell("git ls-remote --tags " + package["git"].get_ref<nl::json::string_t &>(),
-				[&line, &package, &tag_exists](std::string_view out) {
-			size_t i = out.find('\n');
-			if (i == std::string::npos)
-				line += out;
-			else {
-				line.insert(line.end(), out.begin(), out.begin() + i);
-
-				if (line.find("fatal: ") != std::string::npos
-						|| line.size() <= 51 || line.substr(40, 11) != "\trefs/tags/") {
-					throw std::runtime_error("Could not list tags in repository:\n"
-							+ package["git"].get_ref<nl::json::string_t &>());
-				}
-
-				if (line.substr(51) == package["version"])
-					tag_exists = true;
-
-				line = out.substr(i + 1);
-			}
-		});
-
-		if (!tag_exists) {
-			throw std::runtime_error("No " + package["version"].get_ref<nl::json::string_t &>()
-					+ " tag in repository:\n" + package["git"].get_ref<nl::json::string_t &>());
-		}
+		auto &git_url = package["git"].get_ref<nl::json::string_t &>();
+		auto &version = package["version"].get_ref<nl::json::string_t &>();
+
+		auto tags = util::git::list_remote_tags(git_url);
+		if (std::find(tags.begin(), tags.end(), version) == tags.end())
+			throw std::runtime_error("No " + version + " tag in repository:\n" + git_url);
 	} catch (std::exception &e) {
 		std::cout << colors::error << " Failed.\n" << tc::reset;
 		throw e;
@@ -110,12 +91,16 @@ void publish_command::run(const std::vector<std::string> &args) const {
 					std::to_string(response.status) + ".");
 		}
 	});
-	request.on_data([&buffer](const auto &data) {
-		buffer.insert(buffer.end(), data.begin(), data.end());
+	request.on_data([&buffer](http::bytes data) {
+		buffer.append(reinterpret_cast<const char *>(data.data()), data.size());
 	});
 
 	request.send();
 
+	// Manifest changed, cached response of it is outdated
+	if (succeed)
+		http_cache::get().invalidate(url + "package/" + package["id"].get<std::string>() + '/');
+
 	std::cout << (succeed ? colors::success : colors::error);
 	std::cout << '\n' << buffer << '\n' << tc::reset;
 }
@@ -1,6 +1,7 @@
 #include "commands.hpp"
 
 #include "util/file.hpp"
+#include "util/json_projection.hpp"
 #include "util/url.hpp"
 #include "colors.hpp"
 #include "common.hpp"
@@ -42,6 +43,7 @@ void search_command::run(const std::vector<std::string> &args) const {
 			common::getenv("VOLT_PATH") / fs::path("config.json"))
 			)["archives"];
 
+	std::vector<std::string> archive_urls, query_urls;
 	for (auto &archive : archives) {
 		std::string url = archive.first;
 		if (url.back() != '/')
@@ -49,9 +51,22 @@ void search_command::run(const std::vector<std::string> &args) const {
 
 		std::cout << "Searching at \"" << url << "\"..." << std::endl;
 
+		query_urls.push_back(url + url_path);
+		archive_urls.push_back(std::move(url));
+	}
+
+	auto query_results = util::download_all(query_urls);
+
+	// Earlier archives take precedence over the later ones
+	std::vector<std::string> ids, manifest_urls;
+	std::unordered_set<std::string> seen_ids;
+	for (size_t i = 0; i < archive_urls.size(); i++) {
 		nl::json results;
 		try {
-			results = nl::json::parse(util::download(url + url_path));
+			if (query_results[i].error)
+				std::rethrow_exception(query_results[i].error);
+
+			results = nl::json::parse(query_results[i].data);
 		} catch (std::exception &e) {
 			std::cout << colors::warning
 			          << e.what() << '\n'
@@ -61,24 +76,39 @@ void search_command::run(const std::vector<std::string> &args) const {
 
 		for (nl::json &item : results) {
 			std::string id = item;
-			if (packages.contains(id))
+			if (!seen_ids.insert(id).second)
 				continue;
-			
-			std::string manifest_url = url + "package/" + id + '/';
-			nl::json manifest;
-
-			try {
-				manifest = nl::json::parse(util::download(manifest_url));
-			} catch (...) {
-				// If manifest is unavailable, something
-				// went wrong on the server.
-				continue;
-			}
 
-			packages[id] = manifest["description"];
+			manifest_urls.push_back(archive_urls[i] + "package/" + id + '/');
+			ids.push_back(std::move(id));
 		}
 	}
 
+	std::vector<util::json_projection> projections(
+			ids.size(), util::json_projection({ { "description" } }));
+
+	auto errors = util::download_all(manifest_urls,
+			[&projections](size_t index, std::string_view data) {
+		projections[index].feed(data);
+	});
+
+	for (size_t i = 0; i < ids.size(); i++) {
+		nl::json manifest;
+
+		try {
+			if (errors[i])
+				std::rethrow_exception(errors[i]);
+
+			manifest = projections[i].finish();
+		} catch (...) {
+			// If manifest is unavailable, something
+			// went wrong on the server.
+			continue;
+		}
+
+		packages[ids[i]] = manifest["description"];
+	}
+
 	if (packages.empty())
 		throw std::runtime_error("No packages were found.");
 
@@ -1,6 +1,7 @@
 #include "commands.hpp"
 
 #include "util/file.hpp"
+#include "util/json_projection.hpp"
 #include "colors.hpp"
 #include "common.hpp"
 
@@ -30,13 +31,29 @@ void top_command::run(const std::vector<std::string> &args) const {
 	if (packages.empty())
 		throw std::runtime_error("No packages were found.");
 
-	for (nl::json &package : packages) {
-		auto &id = package.get_ref<nl::json::string_t &>();
-		std::string manifest_url = url + "package/" + id + '/';
+	std::vector<std::string> manifest_urls;
+	manifest_urls.reserve(packages.size());
+	for (nl::json &package : packages)
+		manifest_urls.push_back(url + "package/" +
+				package.get_ref<nl::json::string_t &>() + '/');
+
+	std::vector<util::json_projection> projections(packages.size(),
+			util::json_projection({ { "description" }, { "views" } }));
+
+	auto errors = util::download_all(manifest_urls,
+			[&projections](size_t index, std::string_view data) {
+		projections[index].feed(data);
+	});
+
+	for (size_t package_index = 0; package_index < packages.size(); package_index++) {
+		auto &id = packages[package_index].get_ref<nl::json::string_t &>();
+
+		if (errors[package_index])
+			continue;
 
 		nl::json manifest;
 		try {
-			manifest = nl::json::parse(util::download(manifest_url));
+			manifest = projections[package_index].finish();
 		} catch (...) {
 			continue;
 		}
@@ -3,6 +3,7 @@
 #include "util/file.hpp"
 #include "colors.hpp"
 #include "command_manager.hpp"
+#include "lockfile.hpp"
 
 namespace fs = std::filesystem;
 namespace tc = termcolor;
@@ -35,7 +36,8 @@ void uninstall_command::run(const std::vector<std::string> &args) const {
 	if (!fs::exists(package_path))
 		throw std::runtime_error("No \"package.json\" in current directory.");
 
-	nl::json package = nl::json::parse(read_file(package_path));
+	std::string package_contents = read_file(package_path);
+	nl::json package = nl::json::parse(package_contents);
 	nl::json::object_t &deps = package["dependencies"]
 			.get_ref<nl::json::object_t &>();
 
@@ -44,10 +46,33 @@ void uninstall_command::run(const std::vector<std::string> &args) const {
 	}) == 0)
 		throw std::runtime_error("Package has no such dependency.");
 	
-	util::write_file(package_path, package.dump(1, '\t'));
+	std::string previous_hash = lockfile::get_inputs_hash(package_contents);
+	package_contents = package.dump(1, '\t');
+	util::write_file(package_path, package_contents);
 	std::cout << colors::success << "\nFile was written:\n"
 	          << tc::reset << package_path.string() << "\n\n";
 
+	// Install then finds the tree locked and doesn't resolve
+	fs::path lock_path = lockfile::get_path(package_path);
+	auto removed = deps.empty() ? std::nullopt : lockfile::remove_dependency(lock_path,
+			previous_hash, lockfile::get_inputs_hash(package_contents), package, args[0]);
+	if (removed) {
+		std::cout << "Removed " << removed->size()
+		          << (removed->size() == 1 ? " package" : " packages")
+		          << " from \"package-lock.json\".\n\n";
+
+		// Files of packages that aren't needed anymore aren't verified
+		fs::path integrity_path = fs::current_path() / "cache" / "integrity.json";
+		if (fs::exists(integrity_path)) {
+			try {
+				nl::json integrity = nl::json::parse(read_file(integrity_path));
+				for (auto &id : *removed)
+					integrity.erase(id);
+				util::write_file(integrity_path, integrity.dump(1, '\t'));
+			} catch (...) {}
+		}
+	}
+
 	command_manager::find_command("install")
 			->run(std::vector<std::string>());
 }
@@ -2,6 +2,7 @@
 
 #include "util/file.hpp"
 #include "util/http.hpp"
+#include "util/http_cache.hpp"
 #include "util/version.hpp"
 #include "util/url.hpp"
 #include "colors.hpp"
@@ -81,12 +82,16 @@ void unpublish_command::run(const std::vector<std::string> &args) const {
 					std::to_string(response.status) + ".");
 		}
 	});
-	request.on_data([&buffer](const auto &data) {
-		buffer.insert(buffer.end(), data.begin(), data.end());
+	request.on_data([&buffer](http::bytes data) {
+		buffer.append(reinterpret_cast<const char *>(data.data()), data.size());
 	});
 
 	request.send();
 
+	// Manifest changed, cached response of it is outdated
+	if (succeed)
+		http_cache::get().invalidate(url + "package/" + id + '/');
+
 	std::cout << (succeed ? colors::success : colors::error);
 	std::cout << '\n' << buffer << '\n' << tc::reset;
 }
@@ -0,0 +1,127 @@
+#include "commands.hpp"
+
+#include "util/blake3.hpp"
+#include "util/file.hpp"
+#include "util/integrity.hpp"
+#include "util/parallel.hpp"
+#include "colors.hpp"
+#include "common.hpp"
+
+namespace fs = std::filesystem;
+namespace tc = termcolor;
+namespace nl = nlohmann;
+
+namespace commands {
+
+verify_command::verify_command() : command(
+		"verify",
+		"",
+		"Checks files of installed dependencies against hashes\n"
+		"recorded by \"volt install\" in \"cache/integrity.json\".") {}
+
+void verify_command::run(const std::vector<std::string> &args) const {
+	if (args.size() > 0) {
+		std::cout << colors::warning << "Ignoring extra arguments.\n\n"
+		          << tc::reset;
+	}
+
+	fs::path integrity_path = fs::current_path() / "cache" / "integrity.json";
+	if (!fs::exists(integrity_path)) {
+		throw std::runtime_error("No \"cache/integrity.json\" in current "
+				"directory, please run \"volt install\" first.");
+	}
+
+	nl::json integrity = nl::json::parse(util::read_file(integrity_path));
+	fs::path packages_path = common::getenv("VOLT_PATH") / fs::path("packages");
+
+	struct package {
+		std::string id, version;
+		fs::path path;
+		util::file_hashes expected, actual;
+	};
+
+	std::vector<package> packages;
+	for (auto &[id, record] : integrity.items()) {
+		package &pkg = packages.emplace_back();
+		pkg.id = id;
+		pkg.version = record["version"];
+		pkg.path = packages_path / fs::path(id) / pkg.version;
+		pkg.expected = record["files"].get<util::file_hashes>();
+	}
+
+	// Files of all packages are hashed together, so a few
+	// large packages don't leave the other cores idle
+	std::vector<std::pair<package *, fs::path>> files;
+	for (auto &pkg : packages) {
+		if (!fs::is_directory(pkg.path))
+			continue;
+
+		for (auto &entry : fs::recursive_directory_iterator(pkg.path)) {
+			if (fs::is_regular_file(entry.symlink_status()))
+				files.emplace_back(&pkg, entry.path());
+		}
+	}
+
+	std::vector<std::string> hashes(files.size());
+	util::parallel_for(files.size(), util::get_thread_count(), [&](size_t i) {
+		hashes[i] = util::blake3::to_string(util::blake3::hash_file(files[i].second));
+	});
+
+	for (size_t i = 0; i < files.size(); i++) {
+		auto &[pkg, path] = files[i];
+		pkg->actual.emplace(path.lexically_relative(pkg->path)
+				.generic_string(), std::move(hashes[i]));
+	}
+
+	size_t failed_count = 0;
+	for (auto &pkg : packages) {
+		std::vector<std::string> problems;
+
+		if (!fs::is_directory(pkg.path))
+			problems.push_back("Package is not installed.");
+		else {
+			for (auto &[path, hash] : pkg.expected) {
+				auto it = pkg.actual.find(path);
+				if (it == pkg.actual.end())
+					problems.push_back("Missing: " + path);
+				else if (it->second != hash)
+					problems.push_back("Modified: " + path);
+			}
+
+			for (auto &[path, hash] : pkg.actual) {
+				if (!pkg.expected.contains(path))
+					problems.push_back("Unexpected: " + path);
+			}
+		}
+
+		size_t slash_index = pkg.id.find('/');
+		std::cout << colors::main << pkg.id.substr(0, slash_index)
+		          << tc::reset << '/'
+		          << colors::main << pkg.id.substr(slash_index + 1)
+		          << tc::reset << ' ' << pkg.version << ": ";
+
+		if (problems.empty()) {
+			std::cout << colors::success << "OK\n" << tc::reset;
+			continue;
+		}
+
+		failed_count++;
+		std::cout << colors::error << "Failed\n";
+		for (auto &problem : problems)
+			std::cout << "  " << problem << '\n';
+		std::cout << tc::reset;
+	}
+
+	if (failed_count != 0) {
+		throw std::runtime_error(std::to_string(failed_count)
+				+ (failed_count == 1 ? " package" : " packages")
+				+ " failed verification.");
+	}
+
+	std::cout << colors::success << "\nVerified " << packages.size()
+	          << (packages.size() == 1 ? " package" : " packages")
+	          << ", " << files.size()
+	          << (files.size() == 1 ? " file.\n" : " files.\n") << tc::reset;
+}
+
+}
@@ -1,7 +1,9 @@
 #include "common.hpp"
 
 #include "util/file.hpp"
+#include "util/file_lock.hpp"
 #include "util/http.hpp"
+#include "util/http_cache.hpp"
 #include "util/string.hpp"
 #include "util/system.hpp"
 #include "colors.hpp"
@@ -39,6 +41,87 @@ static std::string default_vcvarsall = "vcvars64.bat";
 	#endif
 #endif
 
+// Milliseconds each archive has to respond when racing them
+static constexpr int64_t default_archive_timeout = 10000;
+
+static std::string normalize_archive_url(std::string url) {
+	if (url.back() != '/')
+		url += '/';
+	return url;
+}
+
+// Returns manifest from the first archive in order which has it
+// or null. Sets URL of that archive on success.
+static nl::json probe_archives(const std::vector<std::string> &urls,
+		const std::string &id, bool verbose,
+		const std::vector<json_projection::path> &fields,
+		const nl::json &config, std::string &found_url) {
+	if (config.value("raceArchives", false) && urls.size() > 1) {
+		// Ask all archives at once and keep the first in order that has it
+		auto timeout = std::chrono::milliseconds(
+				config.value("archiveTimeout", default_archive_timeout));
+
+		if (verbose) {
+			std::cout << "Checking at " << urls.size()
+			          << " archives..." << std::endl;
+		}
+
+		std::vector<std::string> package_urls;
+		for (auto &url : urls)
+			package_urls.push_back(url + "package/" + id + '/');
+
+		std::vector<json_projection> projections(urls.size(), json_projection(fields));
+		std::vector<nl::json> manifests(urls.size());
+		// Malformed manifest doesn't win the race
+		auto errors = util::download_first(package_urls,
+				[&projections](size_t index, std::string_view data) {
+			projections[index].feed(data);
+		}, [&projections, &manifests](size_t index) {
+			manifests[index] = projections[index].finish();
+		}, timeout);
+
+		for (size_t i = 0; i < urls.size(); i++) {
+			try {
+				if (errors[i])
+					std::rethrow_exception(errors[i]);
+
+				found_url = urls[i];
+				return std::move(manifests[i]);
+			} catch (std::exception &e) {
+				if (verbose) {
+					std::cout << colors::warning
+					          << "Not found at \"" << urls[i] << "\": "
+					          << e.what() << '\n' << tc::reset;
+				}
+			}
+		}
+	} else {
+		for (auto &url : urls) {
+			if (verbose)
+				std::cout << "Checking at \"" << url << "\"..." << std::endl;
+
+			try {
+				json_projection projection(fields);
+				util::download(url + "package/" + id + '/',
+						[&projection](std::string_view data) {
+					projection.feed(data);
+				});
+
+				nl::json manifest = projection.finish();
+				found_url = url;
+				return manifest;
+			} catch (std::exception &e) {
+				if (verbose) {
+					std::cout << colors::warning
+					          << "Not found: " << e.what() << '\n'
+					          << tc::reset;
+				}
+			}
+		}
+	}
+
+	return nl::json();
+}
 
 namespace common {
 
@@ -59,31 +142,52 @@ std::string get_valid_id(std::string id) {
 	return id;
 }
 
-nl::json find_manifest_in_archives(std::string id, bool verbose) {
+nl::json find_manifest_in_archives(std::string id, bool verbose,
+		const std::vector<json_projection::path> &fields) {
+	fs::path volt_path = common::getenv("VOLT_PATH");
+	nl::json config = nl::json::parse(util::read_file(volt_path / "config.json"));
+	nl::json::object_t archives = config["archives"];
+
+	std::vector<std::string> urls;
+	for (auto &archive : archives)
+		urls.push_back(normalize_archive_url(archive.first));
+
+	std::string scope = id.substr(0, id.find('/'));
+	std::string found_url;
 	nl::json manifest;
 
-	nl::json::object_t archives = nl::json::parse(util::read_file(
-			common::getenv("VOLT_PATH") / fs::path("config.json"))
-			)["archives"];
+	if (config.contains("scopes") && config["scopes"].contains(scope)) {
+		// Configured routes are authoritative
+		urls = { normalize_archive_url(config["scopes"][scope]) };
+		manifest = probe_archives(urls, id, verbose, fields, config, found_url);
+	} else {
+		fs::path routes_path = volt_path / "cache" / "scopes.json";
+		nl::json routes = nl::json::object();
+		try {
+			routes = nl::json::parse(util::read_file(routes_path));
+		} catch (...) {}
+
+		// Learned route is tried alone, then the remaining archives
+		auto learned_url = urls.end();
+		if (routes.contains(scope) && routes[scope].is_string()) {
+			learned_url = std::find(urls.begin(), urls.end(),
+					routes[scope].get_ref<nl::json::string_t &>());
+		}
 
-	for (auto &archive : archives) {
-		std::string url = archive.first;
-		if (url.back() != '/')
-			url += '/';
+		if (learned_url != urls.end()) {
+			std::vector<std::string> learned_urls{ *learned_url };
+			urls.erase(learned_url);
+			manifest = probe_archives(learned_urls, id, verbose, fields, config, found_url);
+		}
 
-		if (verbose)
-			std::cout << "Checking at \"" << url << "\"..." << std::endl;
+		if (manifest.is_null())
+			manifest = probe_archives(urls, id, verbose, fields, config, found_url);
 
-		url += "package/" + id + '/';
-		try {
-			manifest = nl::json::parse(util::download(url));
-			break;
-		} catch (std::exception &e) {
-			if (verbose) {
-				std::cout << colors::warning
-				          << "Not found: " << e.what() << '\n'
-				          << tc::reset;
-			}
+		if (!manifest.is_null() && routes[scope] != found_url) {
+			routes[scope] = found_url;
+			try {
+				util::write_file(routes_path, routes.dump(1, '\t'));
+			} catch (...) {}
 		}
 	}
 
@@ -93,6 +197,103 @@ nl::json find_manifest_in_archives(std::string id, bool verbose) {
 	return manifest;
 }
 
+std::vector<nl::json> find_manifests_in_archives(const std::vector<std::string> &ids,
+		const std::vector<json_projection::path> &fields,
+		std::vector<std::chrono::system_clock::time_point> *times) {
+	fs::path volt_path = common::getenv("VOLT_PATH");
+	nl::json config = nl::json::parse(util::read_file(volt_path / "config.json"));
+	nl::json::object_t archives = config["archives"];
+
+	std::vector<std::string> archive_urls;
+	for (auto &archive : archives)
+		archive_urls.push_back(normalize_archive_url(archive.first));
+
+	fs::path routes_path = volt_path / "cache" / "scopes.json";
+	nl::json routes = nl::json::object();
+	try {
+		routes = nl::json::parse(util::read_file(routes_path));
+	} catch (...) {}
+
+	auto is_configured = [&config](const std::string &scope) {
+		return config.contains("scopes") && config["scopes"].contains(scope);
+	};
+
+	// Configured route alone, otherwise learned route first
+	std::vector<std::vector<std::string>> candidates(ids.size());
+	for (size_t i = 0; i < ids.size(); i++) {
+		std::string scope = ids[i].substr(0, ids[i].find('/'));
+		if (is_configured(scope)) {
+			candidates[i] = { normalize_archive_url(config["scopes"][scope]) };
+			continue;
+		}
+
+		candidates[i] = archive_urls;
+		if (routes.contains(scope) && routes[scope].is_string()) {
+			auto learned_url = std::find(candidates[i].begin(), candidates[i].end(),
+					routes[scope].get_ref<nl::json::string_t &>());
+			if (learned_url != candidates[i].end())
+				std::rotate(candidates[i].begin(), learned_url, std::next(learned_url));
+		}
+	}
+
+	std::vector<nl::json> manifests(ids.size());
+	std::vector<std::string> found_urls(ids.size());
+	if (times)
+		times->assign(ids.size(), std::chrono::system_clock::now());
+
+	// Each round asks the next archive of every package not found yet
+	for (size_t round = 0;; round++) {
+		std::vector<size_t> pending;
+		std::vector<std::string> urls;
+		for (size_t i = 0; i < ids.size(); i++) {
+			if (manifests[i].is_null() && round < candidates[i].size()) {
+				pending.push_back(i);
+				urls.push_back(candidates[i][round] + "package/" + ids[i] + '/');
+			}
+		}
+
+		if (pending.empty())
+			break;
+
+		std::vector<json_projection> projections(pending.size(), json_projection(fields));
+		auto errors = util::download_all(urls,
+				[&projections](size_t index, std::string_view data) {
+			projections[index].feed(data);
+		});
+
+		for (size_t i = 0; i < pending.size(); i++) {
+			if (errors[i])
+				continue;
+
+			try {
+				manifests[pending[i]] = projections[i].finish();
+				found_urls[pending[i]] = candidates[pending[i]][round];
+				if (times) {
+					if (auto entry = util::http_cache::get().find(urls[i]))
+						(*times)[pending[i]] = entry->time;
+				}
+			} catch (...) {}
+		}
+	}
+
+	bool routes_changed = false;
+	for (size_t i = 0; i < ids.size(); i++) {
+		std::string scope = ids[i].substr(0, ids[i].find('/'));
+		if (!manifests[i].is_null() && !is_configured(scope) && routes[scope] != found_urls[i]) {
+			routes[scope] = found_urls[i];
+			routes_changed = true;
+		}
+	}
+
+	if (routes_changed) {
+		try {
+			util::write_file(routes_path, routes.dump(1, '\t'));
+		} catch (...) {}
+	}
+
+	return manifests;
+}
+
 std::string select_archive() {
 	fs::path volt_path = common::getenv("VOLT_PATH");
 	fs::path config_path = volt_path / "config.json";
@@ -181,8 +382,8 @@ nl::json get_user_info(const std::string &token) {
 					std::to_string(response.status) + ".");
 		}
 	});
-	request.on_data([&buffer](const auto &data) {
-		buffer.insert(buffer.end(), data.begin(), data.end());
+	request.on_data([&buffer](http::bytes data) {
+		buffer.append(reinterpret_cast<const char *>(data.data()), data.size());
 	});
 
 	request.send();
@@ -218,8 +419,8 @@ authorization_result authorize(const std::string &archive_url) {
 					std::to_string(response.status) + ".");
 		}
 	});
-	request.on_data([&buffer](const auto &data) {
-		buffer.insert(buffer.end(), data.begin(), data.end());
+	request.on_data([&buffer](http::bytes data) {
+		buffer.append(reinterpret_cast<const char *>(data.data()), data.size());
 	});
 
 	request.set_url("https://github.com/login/device/code");
@@ -310,9 +511,16 @@ authorization_result authorize(const std::string &archive_url) {
 	}
 	util::show_terminal_cursor(true);
 
-	nl::json config = nl::json::parse(util::read_file(config_path));
-	config["archives"][archive_url] = result.token;
-	util::write_file(config_path, config.dump(1, '\t'));
+	{
+		// Other processes may update the config meanwhile
+		fs::path lock_path = config_path;
+		lock_path += ".lock";
+		util::file_lock lock(lock_path);
+
+		nl::json config = nl::json::parse(util::read_file(config_path));
+		config["archives"][archive_url] = result.token;
+		util::write_file(config_path, config.dump(1, '\t'));
+	}
 
 	std::cout << colors::success << "\nFile was written:\n"
 	          << tc::reset << config_path.string() << '\n';
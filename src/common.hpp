@@ -2,6 +2,8 @@
 
 #include "pch.hpp"
 
+#include "util/json_projection.hpp"
+
 namespace common {
 
 struct authorization_result {
@@ -11,7 +13,18 @@ struct authorization_result {
 
 std::string get_valid_id(std::string id);
 
-nlohmann::json find_manifest_in_archives(std::string id, bool verbose = true);
+// Manifest is parsed while being downloaded and only the
+// values at given paths are kept, or all of them if empty
+nlohmann::json find_manifest_in_archives(std::string id, bool verbose = true,
+		const std::vector<util::json_projection::path> &fields = {});
+
+// Looks up all packages concurrently, archives are asked in the same order
+// as by "find_manifest_in_archives". Null for packages which weren't found.
+// "times" receives when each response was received, as kept by the HTTP
+// cache, which is earlier than now if it was served from there.
+std::vector<nlohmann::json> find_manifests_in_archives(const std::vector<std::string> &ids,
+		const std::vector<util::json_projection::path> &fields = {},
+		std::vector<std::chrono::system_clock::time_point> *times = nullptr);
 
 // Returns archive URL
 std::string select_archive();
@@ -0,0 +1,284 @@
+#include "downloader.hpp"
+
+#include "util/blake3.hpp"
+#include "util/file.hpp"
+#include "util/file_lock.hpp"
+#include "util/git.hpp"
+#include "util/http.hpp"
+#include "util/package_store.hpp"
+#include "util/parallel.hpp"
+#include "util/string.hpp"
+#include "util/tar_reader.hpp"
+#include "colors.hpp"
+#include "common.hpp"
+
+namespace fs = std::filesystem;
+namespace tc = termcolor;
+namespace nl = nlohmann;
+
+namespace downloader {
+
+static size_t get_default_job_count() {
+	return std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+}
+
+// Extracts release archive while it downloads
+static void fetch_tarball(const download_job &job, const fs::path &destination) {
+	static const fs::path cert_path = common::getenv("VOLT_PATH") / fs::path("cacert.pem");
+
+	fs::create_directories(destination);
+	util::tar_reader reader(destination, job.tarball_strip);
+
+	util::http request;
+	request.set_certificate(cert_path);
+	request.set_url(job.tarball_url);
+	request.set_follow_redirects(true);
+	request.on_response([](const util::http::response &response) {
+		if (response.status != 200) {
+			throw util::http::error("Remote returned " +
+					std::to_string(response.status) + ".");
+		}
+	});
+	request.on_data([&reader](util::http::bytes data) {
+		reader.feed(data);
+	});
+
+	request.send();
+	reader.finish();
+}
+
+// Mirrors of each git URL keep objects of fetched versions, so later
+// versions transfer just the objects that changed. Files are checked
+// out of them without any git metadata.
+static fs::path get_mirror_path(std::string_view url) {
+	static const fs::path mirrors_path = common::getenv("VOLT_PATH") / fs::path("mirrors");
+
+	util::blake3 hasher;
+	hasher.update(url);
+	return mirrors_path / util::blake3::to_string(hasher.finalize()).substr(0, 32);
+}
+
+static void export_from_mirror(const download_job &job,
+		const fs::path &destination, std::string &output) {
+	fs::path mirror_path = get_mirror_path(job.url);
+
+	// Packages of a monorepo and other processes share the mirror
+	fs::path lock_path = mirror_path;
+	lock_path += ".lock";
+	util::file_lock lock(lock_path);
+
+	auto progress = util::git::export_ref(mirror_path, job.url, job.branch, destination);
+	if (progress.total_objects == 0)
+		output += "Checked out from mirror.\n";
+	else {
+		output += "Fetched " + std::to_string(progress.received_objects) + " objects, "
+				+ std::to_string(progress.received_bytes / 1024) + " KiB.\n";
+	}
+}
+
+static void download_package(const download_job &job,
+		const fs::path &destination, std::string &output) {
+	if (!job.tarball_url.empty()) {
+		try {
+			fetch_tarball(job, destination);
+			output += "Extracted release archive.\n";
+			return;
+		} catch (std::exception &e) {
+			fs::remove_all(destination);
+			if (job.url.empty())
+				throw;
+
+			output += std::string("Release archive failed: ")
+					+ e.what() + "\nFalling back to git.\n";
+		}
+	}
+
+	export_from_mirror(job, destination, output);
+}
+
+static bool is_installed(const fs::path &path) {
+	return fs::is_directory(path) && !fs::is_empty(path);
+}
+
+// Staging directories are only created while holding the lock,
+// so any found then were left behind by an interrupted run
+static void remove_stale_staging(const fs::path &path) {
+	std::string prefix = path.filename().string() + ".tmp";
+	for (auto &entry : fs::directory_iterator(path.parent_path())) {
+		if (entry.is_directory() && entry.path().filename().string().starts_with(prefix))
+			fs::remove_all(entry.path());
+	}
+}
+
+static void check_digest(const download_job &job) {
+	if (!job.digest.empty() && util::get_package_digest(job.files) != job.digest) {
+		throw std::runtime_error("Files don't match digest in \"package-lock.json\", "
+				"release was changed since it was locked.");
+	}
+}
+
+// Downloads into a staging directory next to the package, which is
+// renamed into place once complete. Lock on the package version
+// lets concurrent runs sharing VOLT_PATH reuse each other's downloads.
+static void install_package(download_job &job, size_t hash_thread_count, std::string &output) {
+	fs::path lock_path = job.path;
+	lock_path += ".lock";
+	util::file_lock lock(lock_path, [&output]() {
+		output += "Waiting for another process...\n";
+	});
+
+	if (is_installed(job.path)) {
+		output += "Installed by another process.\n";
+		job.files = util::hash_directory(job.path, hash_thread_count);
+		check_digest(job);
+		return;
+	}
+
+	remove_stale_staging(job.path);
+	fs::path staging_path = util::get_tmp_path(job.path);
+
+	try {
+		download_package(job, staging_path, output);
+
+		auto stored = util::package_store::get().import(staging_path, hash_thread_count);
+		output += "Stored " + std::to_string(stored.file_count) + " files, "
+				+ std::to_string(stored.new_count) + " new, "
+				+ std::to_string(stored.shared_bytes / 1024) + " KiB shared.\n";
+		job.files = std::move(stored.files);
+		check_digest(job);
+
+		// Empty directory may be left by older versions
+		fs::remove_all(job.path);
+		fs::rename(staging_path, job.path);
+	} catch (...) {
+		std::error_code error;
+		fs::remove_all(staging_path, error);
+		throw;
+	}
+}
+
+size_t take_job_count(std::vector<std::string> &args) {
+	auto it = std::find(args.begin(), args.end(), "--jobs");
+	if (it == args.end()) {
+		nl::json config = nl::json::parse(util::read_file(
+				common::getenv("VOLT_PATH") / fs::path("config.json")));
+		if (config.contains("installJobs"))
+			return std::max<size_t>(config["installJobs"].get<size_t>(), 1);
+		return get_default_job_count();
+	}
+
+	if (std::next(it) == args.end())
+		throw std::runtime_error("Missing job count after \"--jobs\".");
+
+	size_t job_count;
+	try {
+		job_count = std::stoul(*std::next(it));
+	} catch (...) {
+		throw std::runtime_error("Invalid job count: " + *std::next(it));
+	}
+
+	args.erase(it, std::next(it, 2));
+	return std::max<size_t>(job_count, 1);
+}
+
+fs::path get_package_path(const resolver::dependency &node) {
+	static const fs::path packages_path = common::getenv("VOLT_PATH") / fs::path("packages");
+	return packages_path / node.scope / node.name / util::to_string(node.version);
+}
+
+std::vector<download_job> get_jobs(resolver::resolution &resolution) {
+	std::vector<download_job> jobs;
+	for (resolver::node_index index : resolution.packages) {
+		auto node = &resolution.graph[index];
+		std::string branch = util::to_string(node->version);
+		fs::path path = get_package_path(*node);
+
+		// If reconstructed from files
+		auto &manifest = resolution.manifests[node->get_id()];
+		auto &release = manifest["releases"][branch];
+		if (!manifest.contains("git") && !release.contains("tarball"))
+			continue;
+
+		try {
+			if (!fs::is_empty(path)) {
+				std::cout << "\nDownloading "
+				          << colors::main << node->scope
+				          << tc::reset << '/'
+				          << colors::main << node->name << ' '
+				          << tc::reset << node->version << ":\n"
+				          << "Already installed.\n";
+				continue;
+			}
+		} catch (...) {}
+
+		download_job job;
+		job.node = node;
+		job.branch = std::move(branch);
+		job.url = manifest.value("git", "");
+		job.path = std::move(path);
+
+		if (release.contains("size") && release["size"].is_number_unsigned())
+			job.size = release["size"];
+		if (release.contains("tarball")) {
+			job.tarball_url = release["tarball"];
+			job.tarball_strip = release.value("tarballStrip", 0);
+		}
+		if (release.contains("digest"))
+			job.digest = release["digest"];
+
+		jobs.push_back(std::move(job));
+	}
+
+	return jobs;
+}
+
+// Installs packages from tarballs or git mirrors on a pool of workers,
+// largest known packages go first so they don't finish last.
+// Returns number of packages which failed to download.
+size_t download(std::vector<download_job> &jobs, size_t job_count) {
+	if (jobs.empty())
+		return 0;
+
+	size_t worker_count = std::min(job_count, jobs.size());
+	std::cout << "\nDownloading " << jobs.size()
+	          << (jobs.size() == 1 ? " package" : " packages")
+	          << " using " << worker_count
+	          << (worker_count == 1 ? " job...\n" : " jobs...\n");
+
+	std::stable_sort(jobs.begin(), jobs.end(), [](auto &a, auto &b) {
+		return a.size.value_or(0) > b.size.value_or(0);
+	});
+
+	size_t hash_thread_count = std::max<size_t>(
+			util::get_thread_count() / std::max<size_t>(worker_count, 1), 1);
+
+	std::atomic<size_t> failed_count = 0;
+	std::mutex output_mutex;
+
+	util::parallel_for(jobs.size(), worker_count, [&](size_t job_index) {
+		auto &job = jobs[job_index];
+		std::string output, error;
+
+		try {
+			install_package(job, hash_thread_count, output);
+		} catch (std::exception &e) {
+			error = e.what();
+			failed_count++;
+		}
+
+		std::lock_guard lock(output_mutex);
+		std::cout << (error.empty() ? "\nDownloaded " : "\nFailed to download ")
+		          << colors::main << job.node->scope
+		          << tc::reset << '/'
+		          << colors::main << job.node->name << ' '
+		          << tc::reset << job.node->version << ":\n"
+		          << output;
+
+		if (!error.empty())
+			std::cout << colors::error << error << '\n' << tc::reset;
+	});
+
+	return failed_count;
+}
+
+}
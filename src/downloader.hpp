@@ -0,0 +1,39 @@
+#pragma once
+
+#include "pch.hpp"
+
+#include "util/integrity.hpp"
+#include "resolver.hpp"
+
+namespace downloader {
+
+struct download_job {
+	const resolver::dependency *node;
+	std::string branch, url;
+	std::filesystem::path path;
+	// Release size in bytes if archive provides it
+	std::optional<uint64_t> size;
+	// Release archive which is preferred over cloning
+	std::string tarball_url;
+	uint32_t tarball_strip = 0;
+	// Package digest recorded by the lockfile, files must match it
+	std::string digest;
+	// Filled once the package is stored
+	util::file_hashes files;
+};
+
+// Removes "--jobs {count}" from arguments, otherwise "installJobs"
+// from "config.json" or the number of CPU threads up to 8
+size_t take_job_count(std::vector<std::string> &args);
+
+// Directory of package version in "$VOLT_PATH/packages/"
+std::filesystem::path get_package_path(const resolver::dependency &node);
+
+// Jobs of resolved packages which are not installed yet
+std::vector<download_job> get_jobs(resolver::resolution &resolution);
+
+// Downloads packages into "$VOLT_PATH/packages/" in parallel.
+// Returns number of packages which failed to download.
+size_t download(std::vector<download_job> &jobs, size_t job_count);
+
+}
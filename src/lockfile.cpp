@@ -0,0 +1,295 @@
+#include "lockfile.hpp"
+
+#include "util/blake3.hpp"
+#include "util/file.hpp"
+#include "util/string.hpp"
+#include "util/version_range.hpp"
+#include "downloader.hpp"
+
+namespace fs = std::filesystem;
+namespace nl = nlohmann;
+
+// Changes whenever records change meaning
+static constexpr std::string_view format = "volt-lock-1\n";
+
+static std::string_view get_name(std::string_view id) {
+	return id.substr(id.find('/') + 1);
+}
+
+static bool is_installed(const fs::path &path) {
+	std::error_code error;
+	return fs::is_directory(path, error) && !fs::is_empty(path, error);
+}
+
+// Manifests of packages reconstructed from files have no sources,
+// so the previous lockfile keeps them for the same version
+static std::unordered_map<std::string, nl::json> read_sources(const fs::path &path) {
+	std::unordered_map<std::string, nl::json> sources;
+	if (!fs::exists(path))
+		return sources;
+
+	try {
+		auto lock = nl::json::parse(util::read_file(path));
+		for (auto &record : lock["packages"]) {
+			std::string key = record["id"].get<std::string>()
+					+ ' ' + record["version"].get<std::string>();
+			sources.emplace(std::move(key), record);
+		}
+	} catch (...) {}
+
+	return sources;
+}
+
+namespace lockfile {
+
+fs::path get_path(const fs::path &package_path) {
+	return package_path.parent_path() / "package-lock.json";
+}
+
+std::string get_inputs_hash(std::string_view package_contents) {
+	util::blake3 hasher;
+	hasher.update(format);
+	hasher.update(package_contents);
+	return util::blake3::to_string(hasher.finalize());
+}
+
+std::optional<resolver::resolution> read(const fs::path &path,
+		std::string_view inputs_hash, const nl::json &package) {
+	if (!fs::exists(path))
+		return std::nullopt;
+
+	// Edited or truncated lock file is resolved again
+	try {
+		auto lock = nl::json::parse(util::read_file(path));
+		if (lock.value("inputs", "") != inputs_hash || !lock["packages"].is_array())
+			return std::nullopt;
+
+		resolver::resolution resolution;
+		auto &graph = resolution.graph;
+		resolver::node_index root = graph.add(package["id"].get<std::string>(),
+				util::version(package["version"]), resolver::dependency::none);
+
+		for (auto &record : lock["packages"]) {
+			std::string version = record["version"];
+			resolver::node_index index = graph.add(record["id"].get<std::string>(),
+					util::version(version), root);
+			auto &node = graph[index];
+
+			// Same shape as manifests of the archive, so downloads are planned alike
+			auto &manifest = resolution.manifests[node.get_id()];
+			auto &release = manifest["releases"][version];
+			if (record.contains("git"))
+				manifest["git"] = record["git"];
+			for (auto key : { "tarball", "tarballStrip", "size" }) {
+				if (record.contains(key))
+					release[key] = record[key];
+			}
+			// Checked once the package is downloaded
+			if (record.contains("digest"))
+				release["digest"] = record["digest"];
+
+			if (!manifest.contains("git") && !release.contains("tarball")
+					&& !is_installed(downloader::get_package_path(node)))
+				return std::nullopt;
+
+			resolution.depths[node.name] = record.at("depth").get<uint32_t>();
+			resolution.packages.push_back(index);
+		}
+
+		return resolution;
+	} catch (...) {
+		return std::nullopt;
+	}
+}
+
+nl::json read_packages(const fs::path &path, std::string_view inputs_hash) {
+	if (!fs::exists(path))
+		return nullptr;
+
+	try {
+		auto lock = nl::json::parse(util::read_file(path));
+		if (lock.value("inputs", "") != inputs_hash || !lock["packages"].is_array())
+			return nullptr;
+
+		for (auto &record : lock["packages"]) {
+			if (!record.contains("dependencies") || !record["dependencies"].is_object())
+				return nullptr;
+		}
+
+		return std::move(lock["packages"]);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+std::optional<std::vector<std::string>> remove_dependency(const fs::path &path,
+		std::string_view previous_hash, std::string_view inputs_hash,
+		const nl::json &package, std::string_view name) {
+	nl::json records = read_packages(path, previous_hash);
+	if (records.is_null())
+		return std::nullopt;
+
+	// One package of each name was selected
+	std::unordered_map<std::string_view, size_t> by_name;
+	for (size_t i = 0; i < records.size(); i++)
+		by_name.emplace(get_name(records[i]["id"].get_ref<const nl::json::string_t &>()), i);
+
+	// Record selected for a dependency, like in resolution it has to be
+	// the same ID in its range. Parsed once, graphs repeat few ranges.
+	std::unordered_map<std::string, util::version_range> ranges;
+	auto find_selection = [&](const std::string &id,
+			const nl::json &range_str) -> std::optional<size_t> {
+		auto it = by_name.find(get_name(id));
+		if (it == by_name.end() || records[it->second]["id"] != id)
+			return std::nullopt;
+
+		auto &str = range_str.get_ref<const nl::json::string_t &>();
+		auto range = ranges.try_emplace(str, str).first;
+		util::version version(records[it->second]["version"].get<std::string>());
+		if (!range->second.contains(version))
+			return std::nullopt;
+		return it->second;
+	};
+
+	// Root is the last node
+	size_t root = records.size();
+	std::vector<std::vector<size_t>> edges(records.size() + 1);
+	std::vector<bool> needed(records.size() + 1);
+	try {
+		std::unordered_set<std::string_view> overridden;
+		for (auto &dep : package["dependencies"].items()) {
+			auto selection = find_selection(dep.key(), dep.value());
+			if (!selection)
+				return std::nullopt;
+			edges[root].push_back(*selection);
+			overridden.insert(get_name(dep.key()));
+		}
+
+		// Dependencies of packages which are still needed
+		std::vector<size_t> pending{ root };
+		needed[root] = true;
+		while (!pending.empty()) {
+			size_t node = pending.back();
+			pending.pop_back();
+
+			if (node != root) {
+				for (auto &dep : records[node]["dependencies"].items()) {
+					std::string_view dep_name = get_name(dep.key());
+					if (dep_name == name)
+						return std::nullopt;
+
+					// Top-level dependencies override the others, dependencies
+					// on releases which don't exist were left out
+					if (overridden.contains(dep_name))
+						edges[node].push_back(by_name.at(dep_name));
+					else if (auto selection = find_selection(dep.key(), dep.value()))
+						edges[node].push_back(*selection);
+				}
+			}
+
+			for (size_t target : edges[node]) {
+				if (!needed[target]) {
+					needed[target] = true;
+					pending.push_back(target);
+				}
+			}
+		}
+	} catch (...) {
+		// Invalid range or version, resolution reports it
+		return std::nullopt;
+	}
+
+	// Longest path from the root, like in resolution
+	std::vector<uint32_t> depths(records.size() + 1), in_degrees(records.size() + 1);
+	for (auto &targets : edges) {
+		for (size_t target : targets)
+			in_degrees[target]++;
+	}
+
+	std::vector<size_t> ready{ root };
+	while (!ready.empty()) {
+		size_t node = ready.back();
+		ready.pop_back();
+
+		for (size_t target : edges[node]) {
+			depths[target] = std::max(depths[target], depths[node] + 1);
+			if (--in_degrees[target] == 0)
+				ready.push_back(target);
+		}
+	}
+
+	// Edited lock file, resolution reports the cycle
+	if (std::any_of(in_degrees.begin(), in_degrees.end(), [](uint32_t degree) { return degree != 0; }))
+		return std::nullopt;
+
+	nl::json packages = nl::json::array();
+	std::vector<std::string> removed;
+	for (size_t i = 0; i < records.size(); i++) {
+		if (!needed[i]) {
+			removed.push_back(records[i]["id"]);
+			continue;
+		}
+
+		records[i]["depth"] = depths[i];
+		packages.push_back(std::move(records[i]));
+	}
+
+	nl::json lock;
+	lock["inputs"] = inputs_hash;
+	lock["packages"] = std::move(packages);
+	util::write_file(path, lock.dump(1, '\t'));
+	return removed;
+}
+
+void write(const fs::path &path, std::string_view inputs_hash,
+		const resolver::resolution &resolution, const nl::json &integrity) {
+	auto previous = read_sources(path);
+
+	nl::json packages = nl::json::array();
+	for (resolver::node_index index : resolution.packages) {
+		auto &node = resolution.graph[index];
+		std::string id = node.get_id();
+		std::string version = util::to_string(node.version);
+
+		nl::json record;
+		record["id"] = id;
+		record["version"] = version;
+		record["depth"] = resolution.depths.at(node.name);
+
+		auto &manifest = resolution.manifests.at(id);
+		auto &release = manifest["releases"][version];
+		if (manifest.contains("git") || release.contains("tarball")) {
+			if (manifest.contains("git"))
+				record["git"] = manifest["git"];
+			for (auto key : { "tarball", "tarballStrip", "size" }) {
+				if (release.contains(key))
+					record[key] = release[key];
+			}
+		} else if (previous.contains(id + ' ' + version)) {
+			auto &source = previous[id + ' ' + version];
+			for (auto key : { "git", "tarball", "tarballStrip", "size" }) {
+				if (source.contains(key))
+					record[key] = source[key];
+			}
+		}
+
+		if (release.contains("dependencies"))
+			record["dependencies"] = release["dependencies"];
+		else if (previous.contains(id + ' ' + version))
+			record["dependencies"] = previous[id + ' ' + version].value("dependencies", nl::json());
+		if (record["dependencies"].is_null())
+			record.erase("dependencies");
+
+		if (integrity.contains(id) && integrity[id].value("version", "") == version)
+			record["digest"] = integrity[id]["digest"];
+
+		packages.push_back(std::move(record));
+	}
+
+	nl::json lock;
+	lock["inputs"] = inputs_hash;
+	lock["packages"] = std::move(packages);
+	util::write_file(path, lock.dump(1, '\t'));
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "pch.hpp"
+
+#include "resolver.hpp"
+
+// "package-lock.json" next to "package.json" records its flattened
+// resolution, so unchanged projects are installed without resolving
+namespace lockfile {
+
+std::filesystem::path get_path(const std::filesystem::path &package_path);
+
+// Hash of everything resolution depends on
+std::string get_inputs_hash(std::string_view package_contents);
+
+// Resolution recorded for the same inputs, empty if there's none or a
+// package would have to be downloaded but its source isn't known
+std::optional<resolver::resolution> read(const std::filesystem::path &path,
+		std::string_view inputs_hash, const nlohmann::json &package);
+
+// Records of the lockfile for the same inputs, with dependencies of each
+// package as written, so resolution after a small change can start from
+// them. Null if there's none or it's older than dependencies in records.
+nlohmann::json read_packages(const std::filesystem::path &path, std::string_view inputs_hash);
+
+// Updates lockfile for "previous_hash" after the root package stopped
+// depending on "name", without resolving: packages nothing else needs are
+// left out and depths are computed again. Returns IDs of the packages left
+// out. Empty if there's no such lockfile, a dependency of the root doesn't
+// match its record or another package depends on that name too, it was
+// overridden so far and has to be resolved now.
+std::optional<std::vector<std::string>> remove_dependency(const std::filesystem::path &path,
+		std::string_view previous_hash, std::string_view inputs_hash,
+		const nlohmann::json &package, std::string_view name);
+
+// "integrity" maps package IDs to records with "digest" of their files
+void write(const std::filesystem::path &path, std::string_view inputs_hash,
+		const resolver::resolution &resolution, const nlohmann::json &integrity);
+
+}
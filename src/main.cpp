@@ -1,11 +1,53 @@
 #include "pch.hpp"
 
+#include "util/http.hpp"
+#include "util/http_cache.hpp"
 #include "util/system.hpp"
 #include "colors.hpp"
 #include "command_manager.hpp"
 
 namespace tc = termcolor;
 
+static void print_timings() {
+	auto log = util::http::get_transfer_log();
+	auto stats = util::http::get_connection_stats();
+
+	auto ms = [](std::chrono::microseconds time) {
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(1) << time.count() / 1000.0;
+		return ss.str();
+	};
+
+	std::cout << colors::main << "\nHTTP timings (milliseconds from start):\n"
+	          << std::setw(9) << "DNS" << std::setw(9) << "Connect"
+	          << std::setw(9) << "TLS" << std::setw(9) << "1st Byte"
+	          << std::setw(9) << "Total" << std::setw(11) << "KiB"
+	          << std::setw(11) << "KiB/s" << std::setw(7) << "Status"
+	          << "  URL\n" << tc::reset;
+
+	std::chrono::microseconds total(0);
+	for (auto &record : log) {
+		auto &timings = record.timings;
+		total += timings.total;
+
+		std::cout << std::setw(9) << ms(timings.name_lookup)
+		          << std::setw(9) << ms(timings.connect)
+		          << std::setw(9) << ms(timings.app_connect)
+		          << std::setw(9) << ms(timings.start_transfer)
+		          << std::setw(9) << ms(timings.total)
+		          << std::fixed << std::setprecision(1)
+		          << std::setw(11) << timings.bytes_received / 1024.0
+		          << std::setw(11) << timings.bytes_per_second / 1024.0
+		          << std::setw(7) << record.status
+		          << "  " << record.method << ' ' << record.url << '\n';
+	}
+
+	std::cout << colors::main << log.size() << " transfers"
+	          << tc::reset << " took " << ms(total) << " ms in total, "
+	          << stats.created << " opened a new connection, "
+	          << stats.reused << " reused one.\n";
+}
+
 int main(int argc, char **argv) {
 	std::signal(SIGINT, [](int) {
 		std::cout << tc::reset;
@@ -17,15 +59,18 @@ int main(int argc, char **argv) {
 	colors::set_from_config();
 	command_manager::init();
 	
-	std::vector<std::string> args;
+	std::vector<std::string> args(argv + 1, argv + argc);
 
-	if (argc == 1)
+	// Global switches may appear anywhere
+	bool show_timings = std::erase(args, "--timings") != 0;
+	util::http::set_log_transfers(show_timings);
+	util::http_cache::set_revalidate_fresh(std::erase(args, "--refresh") != 0);
+
+	if (args.empty())
 		command_manager::find_command("help")->run(args);
 	else {
-		std::string name(argv[1]);
-		args.resize(argc - 2);
-		for (int i = 0; i < argc - 2; i++)
-			args[i] = argv[i + 2];
+		std::string name = std::move(args.front());
+		args.erase(args.begin());
 		
 		const auto &cmd = command_manager::find_command(name);
 		if (cmd) {
@@ -43,6 +88,9 @@ int main(int argc, char **argv) {
 			          << tc::reset << " help\" to list all available.\n";
 	}
 
+	if (show_timings)
+		print_timings();
+
 	std::cout << std::flush;
 	return EXIT_SUCCESS;
 }
@@ -10,7 +10,9 @@
 #endif
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <bit>
 #include <cassert>
 #include <cctype>
 #include <chrono>
@@ -20,16 +22,23 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <optional>
 #include <queue>
+#include <random>
 #include <regex>
+#include <set>
+#include <span>
 #include <sstream>
 #include <stack>
 #include <string>
@@ -37,10 +46,13 @@
 #include <tuple>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <variant>
 #include <vector>
 
 #include <curl/curl.h>
 #include <date/date.h>
+#include <git2.h>
 #include <nlohmann/json.hpp>
 #include <termcolor/termcolor.hpp>
+#include <zlib.h>
@@ -0,0 +1,609 @@
+#include "resolver.hpp"
+
+#include "util/file.hpp"
+#include "util/http_cache.hpp"
+#include "util/manifest_index.hpp"
+#include "util/string.hpp"
+#include "colors.hpp"
+#include "common.hpp"
+
+namespace fs = std::filesystem;
+namespace tc = termcolor;
+namespace nl = nlohmann;
+
+// Manifest values used during dependency resolution
+static const std::vector<util::json_projection::path> resolution_fields{
+	{ "git" }, { "releases", "*", "created" },
+	{ "releases", "*", "dependencies" }, { "releases", "*", "size" },
+	{ "releases", "*", "tarball" }, { "releases", "*", "tarballStrip" }
+};
+
+// Why replacing a dependency with an override is risky, if it is
+static const char *get_override_warning(const resolver::dependency &replacement,
+		std::string_view original_scope, const util::version_range &original_range) {
+	const util::version &new_ver = replacement.version;
+
+	if (replacement.scope != original_scope) {
+		return "Scope was overwritten, now it might "
+				"be a completely different package.";
+	} else if (original_range.contains(new_ver)) {
+		return nullptr;
+	} else if (!original_range.get_exact()) {
+		return "Version is outside of the required range, "
+				"incompatible API will be devastating.";
+	}
+
+	const util::version &old_ver = *original_range.get_exact();
+
+	if (new_ver.major != old_ver.major) {
+		return "Major version was changed, incompatible "
+				"API will be devastating.";
+	} else if (new_ver.major == 0 /* && old_ver.major == 0 */
+			&& new_ver.minor != old_ver.minor) {
+		return "Minor version in development phase was "
+				"changed, incompatible API will be devastating.";
+	} else if (new_ver < old_ver) {
+		if (new_ver.minor != old_ver.minor) {
+			return "Minor version was downgraded, some "
+					"required features are not be available.";
+		} else if (new_ver.patch != old_ver.patch) {
+			return "Patch version was downgraded, some "
+					"required bug-fixes are not present.";
+		} else {
+			return "Pre-release tag was downgraded, some "
+					"required bug-fixes are not available.";
+		}
+	}
+
+	return nullptr;
+}
+
+namespace resolver {
+
+// Manifests of installed packages are used for dependencies on an exact
+// release which is installed, so unchanged trees resolve without network.
+// They come from the manifest index if it has that release, otherwise from
+// "package.json" of the package. Index records as fresh as the HTTP cache
+// are used for any range. Others are downloaded level by level of the tree
+// of their newest matching releases, which is usually what the solver
+// selects, and added to the index. Packages of a previous lockfile only
+// have their locked release, like installed ones.
+class archive_source : public manifest_provider {
+public:
+	archive_source(const nl::json &package, const nl::json &locked);
+
+	std::vector<const nl::json *> load(const std::vector<solver::request> &requests) override;
+
+	const nl::json &get_manifest(const std::string &id) override;
+
+	// Installed and locked packages only have one release
+	bool is_partial(std::string_view id) const override;
+
+	bool has_local_manifests() const noexcept;
+
+	// Following loads of those packages ask archives
+	void forget_local_manifests();
+
+	std::unordered_map<std::string, nl::json> take_manifests();
+
+private:
+	using pending_request = std::pair<std::string, const util::version_range *>;
+
+	enum class origin { remote, loaded, lock, index, installed };
+
+	// Where a manifest is loaded from, decided once per request,
+	// so a record expiring meanwhile doesn't change the decision
+	struct choice {
+		origin from;
+		// Only for installed packages
+		fs::path package_path = {};
+	};
+
+	fs::path packages_path;
+	util::manifest_index &index;
+	// Dependencies on these names are overridden, so they're not prefetched
+	std::unordered_set<std::string> root_names;
+	// Null if not found
+	std::unordered_map<std::string, nl::json> manifests, prefetched, locked;
+	std::unordered_set<std::string> local_ids;
+	bool use_local = true;
+	std::unordered_map<std::string, util::version_range> ranges;
+
+	// Empty if that release isn't installed
+	fs::path get_installed_path(std::string_view id, const util::version_range &range) const;
+
+	bool is_fresh_in_index(std::string_view id) const;
+
+	// Remote if loading it needs network
+	choice choose(const std::string &id, const util::version_range &range) const;
+
+	void prefetch(std::vector<pending_request> level);
+};
+
+archive_source::archive_source(const nl::json &package, const nl::json &locked)
+		: packages_path(common::getenv("VOLT_PATH") / fs::path("packages")),
+		index(util::manifest_index::get()) {
+	for (auto &dep : package["dependencies"].items())
+		root_names.insert(dep.key().substr(dep.key().find('/') + 1));
+
+	if (!locked.is_array())
+		return;
+
+	// Same shape as manifests of the archive
+	for (auto &record : locked) {
+		auto &manifest = this->locked[record["id"].get<std::string>()];
+		auto &release = manifest["releases"][record["version"].get<std::string>()];
+		if (record.contains("git"))
+			manifest["git"] = record["git"];
+		for (auto key : { "tarball", "tarballStrip", "size", "dependencies" }) {
+			if (record.contains(key))
+				release[key] = record[key];
+		}
+	}
+}
+
+std::vector<const nl::json *> archive_source::load(const std::vector<solver::request> &requests) {
+	std::vector<choice> choices;
+	std::vector<pending_request> remote;
+	for (auto &request : requests) {
+		std::string id(request.id);
+		auto &choice = choices.emplace_back(choose(id, *request.range));
+		if (choice.from == origin::remote)
+			remote.emplace_back(std::move(id), request.range);
+	}
+
+	if (!remote.empty())
+		prefetch(std::move(remote));
+
+	std::vector<const nl::json *> result;
+	for (size_t i = 0; i < requests.size(); i++) {
+		auto &request = requests[i];
+		auto &choice = choices[i];
+		std::string id(request.id);
+		size_t slash = id.find('/');
+
+		std::cout << "Checking "
+		          << colors::main << id.substr(0, slash)
+		          << tc::reset << '/'
+		          << colors::main << id.substr(slash + 1)
+		          << tc::reset << ' ' << *request.range << "... ";
+
+		auto cached = manifests.find(id);
+		auto fetched = prefetched.extract(id);
+		if (cached != manifests.end()) {
+			std::cout << "(From Cache)\n";
+		} else if (fetched) {
+			std::cout << (fetched.mapped().is_null() ? "(Not Found)\n" : "(From Remote)\n");
+			cached = manifests.insert(std::move(fetched)).position;
+		} else if (choice.from == origin::lock) {
+			std::cout << "(From Lock)\n";
+			cached = manifests.emplace(id, locked.at(id)).first;
+			local_ids.insert(id);
+		} else if (choice.from == origin::index) {
+			std::cout << "(From Index)\n";
+			cached = manifests.emplace(id, index.find(id)).first;
+		} else {
+			// Installed, so the range is exact. Releases
+			// added since it was indexed might be missing.
+			std::string release = util::to_string(*request.range->get_exact());
+			if (index.has_release(id, release)) {
+				std::cout << "(From Index)\n";
+				cached = manifests.emplace(id, index.find(id)).first;
+			} else {
+				std::cout << "(From Files)\n";
+				auto package = nl::json::parse(util::read_file(choice.package_path));
+				auto manifest = nl::json::object();
+
+				manifest["releases"][release]["dependencies"] = package["dependencies"];
+				cached = manifests.emplace(id, std::move(manifest)).first;
+			}
+			local_ids.insert(id);
+		}
+
+		result.push_back(cached->second.is_null() ? nullptr : &cached->second);
+	}
+
+	return result;
+}
+
+const nl::json &archive_source::get_manifest(const std::string &id) {
+	return manifests[id];
+}
+
+bool archive_source::is_partial(std::string_view id) const {
+	return local_ids.contains(std::string(id));
+}
+
+bool archive_source::has_local_manifests() const noexcept {
+	return !local_ids.empty();
+}
+
+void archive_source::forget_local_manifests() {
+	for (auto &id : local_ids)
+		manifests.erase(id);
+	local_ids.clear();
+	use_local = false;
+}
+
+std::unordered_map<std::string, nl::json> archive_source::take_manifests() {
+	std::erase_if(manifests, [](auto &item) { return item.second.is_null(); });
+	return std::move(manifests);
+}
+
+fs::path archive_source::get_installed_path(std::string_view id, const util::version_range &range) const {
+	if (!use_local || !range.get_exact())
+		return {};
+
+	size_t i = id.find('/');
+	fs::path path = packages_path / id.substr(0, i) / id.substr(i + 1)
+			/ util::to_string(*range.get_exact()) / "package.json";
+	return fs::exists(path) ? path : fs::path();
+}
+
+bool archive_source::is_fresh_in_index(std::string_view id) const {
+	auto time = index.get_time(id);
+	if (!time)
+		return false;
+
+	util::http_cache::entry entry;
+	entry.status = 200;
+	entry.time = *time;
+	return util::http_cache::get().is_fresh(entry);
+}
+
+archive_source::choice archive_source::choose(const std::string &id,
+		const util::version_range &range) const {
+	if (manifests.contains(id) || prefetched.contains(id))
+		return { origin::loaded };
+	if (use_local && locked.contains(id))
+		return { origin::lock };
+	if (is_fresh_in_index(id))
+		return { origin::index };
+	if (fs::path path = get_installed_path(id, range); !path.empty())
+		return { origin::installed, std::move(path) };
+	return { origin::remote };
+}
+
+void archive_source::prefetch(std::vector<pending_request> level) {
+	std::unordered_set<std::string> queued;
+	for (auto &[id, range] : level)
+		queued.insert(id);
+
+	while (!level.empty()) {
+		std::vector<std::string> ids;
+		for (auto &[id, range] : level)
+			ids.push_back(id);
+
+		std::vector<util::manifest_index::time_point> times;
+		auto fetched = common::find_manifests_in_archives(ids, resolution_fields, &times);
+		index.store(ids, fetched, times);
+		std::vector<pending_request> next_level;
+
+		for (size_t i = 0; i < ids.size(); i++) {
+			auto &manifest = prefetched.emplace(ids[i], std::move(fetched[i])).first->second;
+			if (!manifest.is_object() || !manifest["releases"].is_object())
+				continue;
+
+			// Dependencies of the newest release in range
+			const nl::json *deps = nullptr;
+			std::optional<util::version> newest;
+			for (auto &release : manifest["releases"].items()) {
+				try {
+					util::version version(release.key());
+					if (level[i].second->contains(version) && (!newest || version > *newest)) {
+						newest = std::move(version);
+						deps = release.value().contains("dependencies")
+								? &release.value()["dependencies"] : nullptr;
+					}
+				} catch (const std::invalid_argument &) {}
+			}
+
+			if (!deps || !deps->is_object())
+				continue;
+
+			for (auto &dep : deps->items()) {
+				const std::string &id = dep.key();
+				if (!dep.value().is_string() || root_names.contains(id.substr(id.find('/') + 1))
+						|| !queued.insert(id).second)
+					continue;
+
+				auto &range_str = dep.value().get_ref<const nl::json::string_t &>();
+				auto range = ranges.find(range_str);
+				if (range == ranges.end()) {
+					try {
+						range = ranges.emplace(range_str, util::version_range(range_str)).first;
+					} catch (const std::invalid_argument &) {
+						continue;
+					}
+				}
+
+				if (choose(id, range->second).from == origin::remote)
+					next_level.emplace_back(id, &range->second);
+			}
+		}
+
+		level = std::move(next_level);
+	}
+}
+
+std::string dependency::get_id() const {
+	return std::string(id);
+}
+
+std::string dependency::get_str() const {
+	return get_id() + ' ' + util::to_string(version);
+}
+
+node_index dependency_graph::add(std::string_view id,
+		util::version version, node_index parent) {
+	node_index index = static_cast<node_index>(nodes.size());
+	auto &node = nodes.emplace_back();
+
+	auto interned = ids.find(id);
+	if (interned == ids.end()) {
+		std::string_view name = id.substr(id.find('/') + 1);
+		auto name_it = names.find(name);
+		if (name_it == names.end())
+			name_it = names.emplace(name, static_cast<uint32_t>(names.size())).first;
+		interned = ids.emplace(id, name_it->second).first;
+	}
+
+	node.id = interned->first;
+	size_t i = node.id.find('/');
+	node.scope = node.id.substr(0, i);
+	node.name = node.id.substr(i + 1);
+	node.name_index = interned->second;
+	node.version = std::move(version);
+
+	if (parent != dependency::none) {
+		node.parent = parent;
+		node.depth = nodes[parent].depth + 1;
+		nodes[parent].dependencies.push_back(index);
+		children_by_name.try_emplace(get_child_key(parent, node.name_index), index);
+	}
+
+	return index;
+}
+
+node_index dependency_graph::find_child(node_index parent, uint32_t name_index) const {
+	auto it = children_by_name.find(get_child_key(parent, name_index));
+	return it == children_by_name.end() ? dependency::none : it->second;
+}
+
+uint32_t dependency_graph::find_name(std::string_view name) const {
+	auto it = names.find(name);
+	return it == names.end() ? dependency::none : it->second;
+}
+
+size_t dependency_graph::get_name_count() const noexcept {
+	return names.size();
+}
+
+dependency &dependency_graph::operator[](node_index index) noexcept {
+	return nodes[index];
+}
+
+const dependency &dependency_graph::operator[](node_index index) const noexcept {
+	return nodes[index];
+}
+
+size_t dependency_graph::size() const noexcept {
+	return nodes.size();
+}
+
+size_t dependency_graph::string_hash::operator()(std::string_view str) const noexcept {
+	return std::hash<std::string_view>()(str);
+}
+
+uint64_t dependency_graph::get_child_key(node_index parent, uint32_t name_index) noexcept {
+	return static_cast<uint64_t>(parent) << 32 | name_index;
+}
+
+std::string dependency_graph::get_root_path(node_index index) const {
+	std::string path = nodes[index].get_str();
+	for (index = nodes[index].parent; index != dependency::none; index = nodes[index].parent)
+		path = nodes[index].get_str() + " -> " + path;
+	return path;
+}
+
+// Dependencies of a node as written in its manifest
+static const nl::json &get_dependencies(const nl::json &package,
+		const dependency_tree &tree, manifest_provider &manifests, node_index node) {
+	static const nl::json no_dependencies = nl::json::object();
+	if (node == 0)
+		return package["dependencies"];
+
+	auto &releases = manifests.get_manifest(tree.graph[node].get_id())["releases"];
+	auto &release = releases[*tree.releases[node]];
+	return release.contains("dependencies") && release["dependencies"].is_object()
+			? release["dependencies"] : no_dependencies;
+}
+
+dependency_tree build_tree(const nl::json &package,
+		const solver::solution &solution, manifest_provider &manifests) {
+	dependency_tree tree;
+	auto &graph = tree.graph;
+	node_index root = graph.add(package["id"].get<std::string>(),
+			util::version(package["version"]), dependency::none);
+	tree.releases.push_back(nullptr);
+	tree.edges.emplace_back();
+
+	// Selection of each package name
+	std::unordered_map<std::string_view, size_t> selected;
+	for (size_t i = 0; i < solution.packages.size(); i++) {
+		std::string_view id = solution.packages[i].id;
+		selected.emplace(id.substr(id.find('/') + 1), i);
+	}
+
+	std::vector<node_index> selected_nodes(solution.packages.size(), dependency::none);
+	// Parsed once, graphs repeat few ranges
+	std::unordered_map<std::string_view, util::version_range> ranges;
+
+	for (node_index node = root; node < graph.size(); node++) {
+		for (auto &dep : get_dependencies(package, tree, manifests, node).items()) {
+			std::string_view id = dep.key();
+			std::string_view name = id.substr(id.find('/') + 1);
+			auto &range_str = dep.value().get_ref<const nl::json::string_t &>();
+			auto range = ranges.try_emplace(range_str, range_str).first;
+
+			// Top-level dependencies override the others
+			auto it = selected.find(name);
+			bool overridden = node != root && graph.find_child(root,
+					graph.find_name(name)) != dependency::none;
+			auto *selection = it == selected.end() ? nullptr : &solution.packages[it->second];
+
+			if (!selection || (!overridden && (selection->id != id
+					|| !range->second.contains(selection->version)))) {
+				graph[node].warnings.push_back("Package " + graph.get_root_path(node)
+						+ " specifies non-existent release " + range_str
+						+ " of " + std::string(id) + '.');
+				continue;
+			}
+
+			node_index &target = selected_nodes[it->second];
+			if (target == dependency::none) {
+				target = graph.add(selection->id, selection->version, node);
+				tree.releases.push_back(&selection->release);
+				tree.edges.emplace_back();
+			}
+			tree.edges[node].push_back(target);
+
+			if (!overridden)
+				continue;
+
+			if (auto reason = get_override_warning(graph[target],
+					id.substr(0, id.find('/')), range->second)) {
+				graph[node].warnings.push_back(graph[root].get_str()
+						+ " overrides " + graph.get_root_path(node) + " -> "
+						+ std::string(id) + ' ' + range_str + " with "
+						+ graph[target].get_str() + ":\n" + reason);
+			}
+		}
+	}
+
+	return tree;
+}
+
+std::vector<uint32_t> compute_depths(const nl::json &package,
+		const dependency_tree &tree, manifest_provider &manifests) {
+	auto &graph = tree.graph;
+	auto &edges = tree.edges;
+
+	std::vector<uint32_t> depths(graph.size()), in_degrees(graph.size());
+	for (auto &targets : edges) {
+		for (node_index target : targets)
+			in_degrees[target]++;
+	}
+
+	std::vector<node_index> ready;
+	for (node_index node = 0; node < graph.size(); node++) {
+		if (in_degrees[node] == 0)
+			ready.push_back(node);
+	}
+
+	size_t visited = 0;
+	while (!ready.empty()) {
+		node_index node = ready.back();
+		ready.pop_back();
+		visited++;
+
+		for (node_index target : edges[node]) {
+			depths[target] = std::max(depths[target], depths[node] + 1);
+			if (--in_degrees[target] == 0)
+				ready.push_back(target);
+		}
+	}
+
+	if (visited == graph.size())
+		return depths;
+
+	// Nodes left all have a dependant which is left,
+	// so walking back along them ends up in a cycle
+	std::vector<node_index> dependants(graph.size(), dependency::none);
+	for (node_index node = 0; node < graph.size(); node++) {
+		for (node_index target : edges[node]) {
+			if (in_degrees[node] != 0 && in_degrees[target] != 0)
+				dependants[target] = node;
+		}
+	}
+
+	node_index node = static_cast<node_index>(std::find_if(in_degrees.begin(),
+			in_degrees.end(), [](uint32_t degree) { return degree != 0; }) - in_degrees.begin());
+	std::vector<bool> seen(graph.size());
+	for (; !seen[node]; node = dependants[node])
+		seen[node] = true;
+
+	// Dependencies as written, overrides may have changed the scope
+	std::string path;
+	bool ambiguous = false;
+	node_index cycle_node = node;
+	do {
+		node_index dependant = dependants[cycle_node];
+		for (auto &dep : get_dependencies(package, tree, manifests, dependant).items()) {
+			std::string_view id = dep.key();
+			if (id.substr(id.find('/') + 1) != graph[cycle_node].name)
+				continue;
+
+			ambiguous |= id != graph[cycle_node].id;
+			path = " -> " + dep.key() + ' ' + dep.value().get<std::string>() + path;
+			break;
+		}
+		cycle_node = dependant;
+	} while (cycle_node != node);
+
+	throw std::runtime_error((ambiguous ? "Circular reference with ambiguous scope:\n"
+			: "Circular reference:\n") + graph.get_root_path(node) + path);
+}
+
+resolution flatten(dependency_tree tree, const std::vector<uint32_t> &depths) {
+	resolution result;
+	for (node_index node = 1; node < tree.graph.size(); node++) {
+		result.packages.push_back(node);
+		result.depths.emplace(tree.graph[node].name, depths[node]);
+		result.warning_count += static_cast<uint32_t>(tree.graph[node].warnings.size());
+	}
+	result.graph = std::move(tree.graph);
+	return result;
+}
+
+resolution resolve(const nl::json &package, const nl::json &locked) {
+	std::cout << "Resolving dependencies...\n";
+
+	archive_source source(package, locked);
+	solver::solution solution;
+	try {
+		solution = solver::solve(package, source);
+	} catch (const std::runtime_error &) {
+		if (!source.has_local_manifests())
+			throw;
+
+		std::cout << "\nInstalled and locked packages don't satisfy all "
+				"dependencies, checking archives...\n";
+		source.forget_local_manifests();
+		solution = solver::solve(package, source);
+	}
+
+	std::cout << "\nSelected " << solution.packages.size() << " packages after "
+	          << solution.decision_count << " decisions and "
+	          << solution.conflict_count << " conflicts.\n";
+
+	std::cout << "\nBuilding dependency tree...\n";
+	dependency_tree tree = build_tree(package, solution, source);
+
+	std::cout << "\nComputing package depths...\n";
+	std::vector<uint32_t> depths = compute_depths(package, tree, source);
+
+	resolution result = flatten(std::move(tree), depths);
+	result.manifests = source.take_manifests();
+
+	std::cout << colors::warning;
+	for (node_index node : result.packages) {
+		for (std::string &warning : result.graph[node].warnings)
+			std::cout << '\n' << warning << '\n';
+	}
+	std::cout << tc::reset;
+
+	return result;
+}
+
+}
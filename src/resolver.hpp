@@ -0,0 +1,137 @@
+#pragma once
+
+#include "pch.hpp"
+
+#include "util/version.hpp"
+#include "solver.hpp"
+
+namespace resolver {
+
+using node_index = uint32_t;
+
+// Package in the dependency tree, refers to other nodes by index
+struct dependency {
+	static constexpr node_index none = UINT32_MAX;
+
+	// Interned by the graph, "id" is "{scope}/{name}"
+	std::string_view id, scope, name;
+	// Equal for equal names
+	uint32_t name_index = 0;
+	util::version version;
+	node_index parent = none;
+	uint32_t depth = 0;
+	std::vector<node_index> dependencies;
+	std::vector<std::string> warnings;
+
+	std::string get_id() const;
+
+	std::string get_str() const;
+};
+
+// Dependency tree in one array, root is the first node
+class dependency_graph {
+public:
+	dependency_graph() = default;
+
+	// Nodes view strings owned by the graph, which a copy would
+	// still point to. Moving keeps them where they are.
+	dependency_graph(const dependency_graph &) = delete;
+
+	dependency_graph(dependency_graph &&) = default;
+
+	dependency_graph &operator=(const dependency_graph &) = delete;
+
+	dependency_graph &operator=(dependency_graph &&) = default;
+
+	// Attaches node to its parent, references to nodes are invalidated
+	node_index add(std::string_view id, util::version version, node_index parent);
+
+	// Child of that name, "none" if there's no such child
+	node_index find_child(node_index parent, uint32_t name_index) const;
+
+	// Index shared by nodes of that name, "none" if there are no such nodes
+	uint32_t find_name(std::string_view name) const;
+
+	// Name indices are below this
+	size_t get_name_count() const noexcept;
+
+	dependency &operator[](node_index index) noexcept;
+
+	const dependency &operator[](node_index index) const noexcept;
+
+	size_t size() const noexcept;
+
+	// Chain of packages from the root, only built for diagnostics
+	std::string get_root_path(node_index index) const;
+
+private:
+	// Looks up strings by views without copying them
+	struct string_hash {
+		using is_transparent = void;
+
+		size_t operator()(std::string_view str) const noexcept;
+	};
+
+	using string_index = std::unordered_map<std::string,
+			uint32_t, string_hash, std::equal_to<>>;
+
+	std::vector<dependency> nodes;
+	// Name index of each ID and of each name. Node-based,
+	// so views of the keys stay valid.
+	string_index ids, names;
+	// Parent index in high and name index in low half
+	std::unordered_map<uint64_t, node_index> children_by_name;
+
+	static uint64_t get_child_key(node_index parent, uint32_t name_index) noexcept;
+};
+
+// Dependencies of a package flattened to one version of each package name
+struct resolution {
+	dependency_graph graph;
+	// Breadth-first order
+	std::vector<node_index> packages;
+	// Deepest level at which each package name appears, names are interned
+	std::map<std::string_view, uint32_t> depths;
+	// By package ID, reconstructed from files for installed packages
+	std::unordered_map<std::string, nlohmann::json> manifests;
+	uint32_t warning_count = 0;
+};
+
+// Gives manifests to the solver and keeps them for the following phases
+class manifest_provider : public solver::manifest_source {
+public:
+	// Manifest which was loaded before
+	virtual const nlohmann::json &get_manifest(const std::string &id) = 0;
+};
+
+// Selected packages, each attached where it's first reached from the root
+struct dependency_tree {
+	dependency_graph graph;
+	// Dependencies of each node, including ones attached elsewhere
+	std::vector<std::vector<node_index>> edges;
+	// Key in "releases" of each node, null for the root
+	std::vector<const std::string *> releases;
+};
+
+// Phases of "resolve" after "solver::solve", they don't print anything
+
+// Dependencies which are overridden or have no selected release
+// get warnings in their dependant's node
+dependency_tree build_tree(const nlohmann::json &package,
+		const solver::solution &solution, manifest_provider &manifests);
+
+// Longest path from the root to each node, so packages are deeper than
+// their dependants. Throws with the path of the first cycle found.
+std::vector<uint32_t> compute_depths(const nlohmann::json &package,
+		const dependency_tree &tree, manifest_provider &manifests);
+
+// Resolution without manifests
+resolution flatten(dependency_tree tree, const std::vector<uint32_t> &depths);
+
+// Selects a release of each dependency of "package.json" contents and
+// builds the tree of them, printing progress and warnings. Throws on
+// conflicts and cycles. Packages in "locked" records of a previous
+// lockfile keep their release, unless that makes resolution fail.
+resolution resolve(const nlohmann::json &package, const nlohmann::json &locked = nullptr);
+
+}
@@ -0,0 +1,849 @@
+#include "solver.hpp"
+
+#include "util/string.hpp"
+
+namespace nl = nlohmann;
+
+namespace solver {
+
+static constexpr uint32_t none = UINT32_MAX;
+// Returned by propagation when all terms of an incompatibility hold
+static constexpr uint32_t conflict = UINT32_MAX - 1;
+static constexpr uint32_t root = 0;
+
+// Subset of releases of one package, bit i stands for the i-th newest.
+// Packages rarely have over 64 releases, so those sets don't allocate.
+class release_set {
+public:
+	release_set() = default;
+
+	release_set(size_t size, bool full) : size(size) {
+		if (size > 64)
+			extra.resize((size - 1) / 64);
+
+		if (full) {
+			word = ~uint64_t(0);
+			std::fill(extra.begin(), extra.end(), ~uint64_t(0));
+			trim();
+		}
+	}
+
+	static release_set single(size_t size, size_t index) {
+		release_set set(size, false);
+		set.insert(index);
+		return set;
+	}
+
+	void insert(size_t index) noexcept {
+		get(index / 64) |= uint64_t(1) << index % 64;
+	}
+
+	release_set operator&(const release_set &rhs) const {
+		release_set result = *this;
+		for (size_t i = 0; i < get_word_count(); i++)
+			result.get(i) &= rhs.get(i);
+		return result;
+	}
+
+	release_set operator~() const {
+		release_set result = *this;
+		for (size_t i = 0; i < get_word_count(); i++)
+			result.get(i) = ~get(i);
+		result.trim();
+		return result;
+	}
+
+	bool empty() const noexcept {
+		for (size_t i = 0; i < get_word_count(); i++) {
+			if (get(i) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	bool full() const noexcept {
+		return count() == size;
+	}
+
+	bool subset_of(const release_set &rhs) const noexcept {
+		for (size_t i = 0; i < get_word_count(); i++) {
+			if ((get(i) & ~rhs.get(i)) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	bool intersects(const release_set &rhs) const noexcept {
+		for (size_t i = 0; i < get_word_count(); i++) {
+			if ((get(i) & rhs.get(i)) != 0)
+				return true;
+		}
+		return false;
+	}
+
+	size_t count() const noexcept {
+		size_t result = 0;
+		for (size_t i = 0; i < get_word_count(); i++)
+			result += std::popcount(get(i));
+		return result;
+	}
+
+	// Newest release in the set, "size" if it's empty
+	size_t first() const noexcept {
+		for (size_t i = 0; i < get_word_count(); i++) {
+			if (get(i) != 0)
+				return i * 64 + std::countr_zero(get(i));
+		}
+		return size;
+	}
+
+	bool contains(size_t index) const noexcept {
+		return (get(index / 64) >> index % 64 & 1) != 0;
+	}
+
+private:
+	uint64_t word = 0;
+	std::vector<uint64_t> extra;
+	size_t size = 0;
+
+	size_t get_word_count() const noexcept {
+		return extra.size() + 1;
+	}
+
+	uint64_t get(size_t index) const noexcept {
+		return index == 0 ? word : extra[index - 1];
+	}
+
+	uint64_t &get(size_t index) noexcept {
+		return index == 0 ? word : extra[index - 1];
+	}
+
+	void trim() noexcept {
+		if (size % 64 != 0)
+			get(get_word_count() - 1) &= (uint64_t(1) << size % 64) - 1;
+		else if (size == 0)
+			word = 0;
+	}
+};
+
+// Releases of a package, and not installing it at all if "absent" is set.
+// Positive terms need the package, negative ones hold without it.
+struct term {
+	uint32_t package;
+	release_set releases;
+	bool absent;
+};
+
+static term intersect(const term &lhs, const term &rhs) {
+	return { lhs.package, lhs.releases & rhs.releases, lhs.absent && rhs.absent };
+}
+
+static term negate(const term &value) {
+	return { value.package, ~value.releases, !value.absent };
+}
+
+static bool is_positive(const term &value) noexcept {
+	return !value.absent;
+}
+
+static bool is_empty(const term &value) noexcept {
+	return !value.absent && value.releases.empty();
+}
+
+static bool is_universal(const term &value) noexcept {
+	return value.absent && value.releases.full();
+}
+
+// Every outcome "lhs" allows is allowed by "rhs"
+static bool satisfies(const term &lhs, const term &rhs) noexcept {
+	return lhs.releases.subset_of(rhs.releases) && (!lhs.absent || rhs.absent);
+}
+
+// No outcome is allowed by both
+static bool contradicts(const term &lhs, const term &rhs) noexcept {
+	return !lhs.releases.intersects(rhs.releases) && !(lhs.absent && rhs.absent);
+}
+
+enum class cause {
+	root, dependency, same_name, derived
+};
+
+// Terms which can't all hold at once
+struct incompatibility {
+	std::vector<term> terms;
+	solver::cause cause;
+	// Both incompatibilities a derived one was learned from
+	uint32_t left = none, right = none;
+	// Dependant release and dependency range as written
+	uint32_t package = none, release = 0, dependency = none;
+	std::string_view range;
+};
+
+struct package {
+	std::string id;
+	std::string_view name;
+	// Null if it wasn't found and for the root
+	const nl::json *manifest = nullptr;
+	bool partial = false;
+	// Keys of "releases", newest first
+	std::vector<std::string_view> releases;
+	std::vector<const util::version *> versions;
+	std::vector<uint32_t> incompatibilities;
+	// Assignments of this package and what
+	// all of them allow up to each of them
+	std::vector<uint32_t> assignments;
+	std::vector<term> narrowed;
+	// Release index if selected
+	uint32_t decision = none;
+	std::vector<bool> dependencies_added;
+};
+
+struct assignment {
+	term value;
+	uint32_t level;
+	// Incompatibility it was derived from, "none" for decisions
+	uint32_t cause;
+};
+
+enum class relation {
+	satisfied, contradicted, inconclusive
+};
+
+class version_solver {
+public:
+	version_solver(const nl::json &package, manifest_source &source);
+
+	solution solve();
+
+private:
+	manifest_source &source;
+	const nl::json &root_package;
+	// Names which top-level dependencies override
+	std::unordered_set<std::string_view> root_names;
+
+	// Stable, names and IDs are viewed
+	std::deque<package> packages;
+	std::unordered_map<std::string_view, uint32_t> package_indices;
+	std::unordered_map<std::string_view, std::vector<uint32_t>> names;
+
+	std::vector<incompatibility> incompatibilities;
+	std::vector<assignment> assignments;
+	// Release count and index of packages which are needed and undecided,
+	// pushed whenever their term changes. Outdated entries are skipped.
+	std::priority_queue<std::pair<size_t, uint32_t>,
+			std::vector<std::pair<size_t, uint32_t>>, std::greater<>> candidates;
+	uint32_t level = 0;
+	size_t decision_count = 0, conflict_count = 0;
+
+	// Parsing is slow and graphs repeat few strings
+	std::unordered_map<std::string_view, util::version> versions;
+	std::unordered_map<std::string_view, util::version_range> ranges;
+
+	const util::version_range &get_range(std::string_view str, uint32_t owner);
+
+	const nl::json *get_dependencies(uint32_t package, size_t release) const;
+
+	void add_package(std::string_view id, const nl::json *manifest);
+
+	// Merges terms of the same package and drops ones which always hold
+	void normalize(incompatibility &value) const;
+
+	uint32_t store(incompatibility &&value);
+
+	void attach(uint32_t index);
+
+	std::vector<uint32_t> add_dependencies(uint32_t package, size_t release);
+
+	void assign(term value, uint32_t cause);
+
+	// Makes package a candidate for decisions if it's needed and undecided
+	void enqueue(uint32_t package);
+
+	void decide(uint32_t package, size_t release);
+
+	void backtrack(uint32_t target_level);
+
+	relation relate(const term &value) const;
+
+	// Derives the only undecided term, returns its package,
+	// "conflict" if all terms hold or "none" otherwise
+	uint32_t propagate(uint32_t index);
+
+	void propagate_from(uint32_t package);
+
+	// Learns the root cause and backjumps, returns learned incompatibility
+	uint32_t resolve_conflict(uint32_t index);
+
+	// Earliest assignment after which the term holds
+	uint32_t find_satisfier(const term &value) const;
+
+	// Package of the next decision, "none" when solution is complete
+	uint32_t choose();
+
+	std::string describe(const term &value) const;
+
+	std::string describe(uint32_t index) const;
+
+	std::string explain(uint32_t index) const;
+};
+
+version_solver::version_solver(const nl::json &package, manifest_source &source)
+		: source(source), root_package(package) {
+	for (auto &dep : package["dependencies"].items()) {
+		std::string_view id = dep.key();
+		root_names.insert(id.substr(id.find('/') + 1));
+	}
+}
+
+solution version_solver::solve() {
+	add_package(root_package["id"].get_ref<const nl::json::string_t &>(), nullptr);
+
+	// Root must be selected
+	incompatibility root_incompatibility;
+	root_incompatibility.terms.push_back({ root, release_set(1, false), true });
+	root_incompatibility.cause = cause::root;
+	attach(store(std::move(root_incompatibility)));
+
+	for (uint32_t next = root; next != none; next = choose())
+		propagate_from(next);
+
+	solution result;
+	for (auto &entry : assignments) {
+		auto &pkg = packages[entry.value.package];
+		if (entry.cause != none || entry.value.package == root)
+			continue;
+
+		result.packages.push_back({ pkg.id, std::string(pkg.releases[pkg.decision]),
+				*pkg.versions[pkg.decision] });
+	}
+
+	result.decision_count = decision_count;
+	result.conflict_count = conflict_count;
+	return result;
+}
+
+const util::version_range &version_solver::get_range(std::string_view str, uint32_t owner) {
+	auto it = ranges.find(str);
+	if (it != ranges.end())
+		return it->second;
+
+	try {
+		return ranges.emplace(str, util::version_range(str)).first->second;
+	} catch (const std::invalid_argument &e) {
+		throw std::runtime_error(packages[owner].id + " has an invalid dependency:\n" + e.what());
+	}
+}
+
+const nl::json *version_solver::get_dependencies(uint32_t package, size_t release) const {
+	const nl::json *deps;
+	if (package == root)
+		deps = &root_package["dependencies"];
+	else {
+		auto &releases = (*packages[package].manifest)["releases"];
+		auto it = releases.find(packages[package].releases[release]);
+		if (it == releases.end() || !it->contains("dependencies"))
+			return nullptr;
+		deps = &(*it)["dependencies"];
+	}
+
+	return deps->is_object() ? deps : nullptr;
+}
+
+void version_solver::add_package(std::string_view id, const nl::json *manifest) {
+	uint32_t index = static_cast<uint32_t>(packages.size());
+	auto &pkg = packages.emplace_back();
+	pkg.id = id;
+	pkg.name = std::string_view(pkg.id).substr(pkg.id.find('/') + 1);
+	pkg.manifest = manifest;
+	pkg.partial = manifest && index != root && source.is_partial(id);
+
+	if (index == root) {
+		auto &version = root_package["version"].get_ref<const nl::json::string_t &>();
+		pkg.releases.push_back(version);
+		pkg.versions.push_back(&versions.try_emplace(version, version).first->second);
+	} else if (manifest && manifest->contains("releases") && (*manifest)["releases"].is_object()) {
+		for (auto &release : (*manifest)["releases"].items()) {
+			std::string_view key = release.key();
+			auto parsed = versions.find(key);
+			if (parsed == versions.end()) {
+				try {
+					parsed = versions.emplace(key, util::version(release.key())).first;
+				} catch (const std::invalid_argument &) {
+					continue;
+				}
+			}
+
+			pkg.releases.push_back(key);
+			pkg.versions.push_back(&parsed->second);
+		}
+
+		// Newest first, so bit order is preference order
+		std::vector<size_t> order(pkg.releases.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&pkg](size_t a, size_t b) {
+			return *pkg.versions[a] > *pkg.versions[b];
+		});
+
+		std::vector<std::string_view> releases;
+		std::vector<const util::version *> sorted_versions;
+		for (size_t i : order) {
+			releases.push_back(pkg.releases[i]);
+			sorted_versions.push_back(pkg.versions[i]);
+		}
+		pkg.releases = std::move(releases);
+		pkg.versions = std::move(sorted_versions);
+	}
+
+	pkg.dependencies_added.resize(pkg.releases.size());
+	package_indices.emplace(pkg.id, index);
+
+	// Flattened tree has one package of each name
+	auto &same_name = names[pkg.name];
+	for (uint32_t other : same_name) {
+		incompatibility clash;
+		clash.terms.push_back({ other, release_set(packages[other].releases.size(), true), false });
+		clash.terms.push_back({ index, release_set(pkg.releases.size(), true), false });
+		clash.cause = cause::same_name;
+		attach(store(std::move(clash)));
+	}
+	same_name.push_back(index);
+}
+
+void version_solver::normalize(incompatibility &value) const {
+	std::vector<term> terms;
+	for (auto &t : value.terms) {
+		auto it = std::find_if(terms.begin(), terms.end(),
+				[&t](auto &other) { return other.package == t.package; });
+		if (it == terms.end())
+			terms.push_back(t);
+		else
+			*it = intersect(*it, t);
+	}
+
+	std::erase_if(terms, [](auto &t) { return is_universal(t); });
+
+	// Root is always selected, so it only adds noise to learned terms
+	if (value.cause == cause::derived && terms.size() > 1) {
+		std::erase_if(terms, [](auto &t) {
+			return t.package == root && is_positive(t);
+		});
+	}
+
+	value.terms = std::move(terms);
+}
+
+uint32_t version_solver::store(incompatibility &&value) {
+	normalize(value);
+	incompatibilities.push_back(std::move(value));
+	return static_cast<uint32_t>(incompatibilities.size() - 1);
+}
+
+void version_solver::attach(uint32_t index) {
+	for (auto &t : incompatibilities[index].terms)
+		packages[t.package].incompatibilities.push_back(index);
+}
+
+std::vector<uint32_t> version_solver::add_dependencies(uint32_t package, size_t release) {
+	packages[package].dependencies_added[release] = true;
+	const nl::json *deps = get_dependencies(package, release);
+	if (!deps)
+		return {};
+
+	// Manifests of a release's dependencies are requested together
+	std::vector<request> requests;
+	std::unordered_set<std::string_view> requested;
+	for (auto &dep : deps->items()) {
+		std::string_view id = dep.key();
+		if (package != root && root_names.contains(id.substr(id.find('/') + 1)))
+			continue;
+
+		auto &range = get_range(dep.value().get_ref<const nl::json::string_t &>(), package);
+		if (!package_indices.contains(id) && requested.insert(id).second)
+			requests.push_back({ id, &range });
+	}
+
+	if (!requests.empty()) {
+		auto manifests = source.load(requests);
+		for (size_t i = 0; i < requests.size(); i++)
+			add_package(requests[i].id, manifests[i]);
+	}
+
+	std::vector<uint32_t> added;
+	for (auto &dep : deps->items()) {
+		std::string_view id = dep.key();
+		if (package != root && root_names.contains(id.substr(id.find('/') + 1)))
+			continue;
+
+		uint32_t dependency = package_indices[id];
+		auto &target = packages[dependency];
+		std::string_view range_str = dep.value().get_ref<const nl::json::string_t &>();
+		auto &range = get_range(range_str, package);
+
+		release_set allowed(target.releases.size(), false);
+		for (size_t i = 0; i < target.releases.size(); i++) {
+			if (range.contains(*target.versions[i]))
+				allowed.insert(i);
+		}
+
+		// Published manifests may point to releases which
+		// were removed since, those dependencies are left out
+		if (allowed.empty() && target.manifest && !target.partial && package != root)
+			continue;
+
+		// Release together with the dependency missing or out of range
+		incompatibility value;
+		value.terms.push_back({ package, release_set::single(
+				packages[package].releases.size(), release), false });
+		value.terms.push_back({ dependency, ~allowed, true });
+		value.cause = cause::dependency;
+		value.package = package;
+		value.release = static_cast<uint32_t>(release);
+		value.dependency = dependency;
+		value.range = range_str;
+
+		uint32_t index = store(std::move(value));
+		attach(index);
+		added.push_back(index);
+	}
+
+	return added;
+}
+
+void version_solver::assign(term value, uint32_t cause) {
+	uint32_t package = value.package;
+	auto &pkg = packages[package];
+	pkg.narrowed.push_back(pkg.narrowed.empty() ? value : intersect(pkg.narrowed.back(), value));
+	pkg.assignments.push_back(static_cast<uint32_t>(assignments.size()));
+	assignments.push_back({ std::move(value), level, cause });
+	enqueue(package);
+}
+
+void version_solver::enqueue(uint32_t package) {
+	auto &pkg = packages[package];
+	if (pkg.decision == none && !pkg.narrowed.empty() && is_positive(pkg.narrowed.back()))
+		candidates.emplace(pkg.narrowed.back().releases.count(), package);
+}
+
+void version_solver::decide(uint32_t package, size_t release) {
+	level++;
+	decision_count++;
+	packages[package].decision = static_cast<uint32_t>(release);
+	assign({ package, release_set::single(packages[package].releases.size(), release), false }, none);
+}
+
+void version_solver::backtrack(uint32_t target_level) {
+	while (!assignments.empty() && assignments.back().level > target_level) {
+		auto &last = assignments.back();
+		uint32_t package = last.value.package;
+		auto &pkg = packages[package];
+		pkg.assignments.pop_back();
+		pkg.narrowed.pop_back();
+		if (last.cause == none)
+			pkg.decision = none;
+		assignments.pop_back();
+		enqueue(package);
+	}
+
+	level = target_level;
+}
+
+relation version_solver::relate(const term &value) const {
+	auto &narrowed = packages[value.package].narrowed;
+	// Package without assignments may be anything, and universal
+	// terms are never stored, so nothing is satisfied by that
+	if (narrowed.empty())
+		return is_empty(value) ? relation::contradicted : relation::inconclusive;
+
+	if (satisfies(narrowed.back(), value))
+		return relation::satisfied;
+	if (contradicts(narrowed.back(), value))
+		return relation::contradicted;
+	return relation::inconclusive;
+}
+
+uint32_t version_solver::propagate(uint32_t index) {
+	const term *unsatisfied = nullptr;
+	for (auto &t : incompatibilities[index].terms) {
+		switch (relate(t)) {
+		case relation::contradicted:
+			return none;
+		case relation::inconclusive:
+			if (unsatisfied)
+				return none;
+			unsatisfied = &t;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (!unsatisfied)
+		return conflict;
+
+	uint32_t package = unsatisfied->package;
+	assign(negate(*unsatisfied), index);
+	return package;
+}
+
+void version_solver::propagate_from(uint32_t package) {
+	std::vector<uint32_t> changed{ package };
+
+	while (!changed.empty()) {
+		uint32_t current = changed.back();
+		changed.pop_back();
+
+		// Newest incompatibilities are the most specific
+		for (size_t i = packages[current].incompatibilities.size(); i-- > 0;) {
+			uint32_t result = propagate(packages[current].incompatibilities[i]);
+
+			if (result == conflict) {
+				// Learned incompatibility is almost satisfied after backjumping
+				result = propagate(resolve_conflict(packages[current].incompatibilities[i]));
+				changed.clear();
+				if (result != none && result != conflict)
+					changed.push_back(result);
+				break;
+			}
+
+			if (result != none)
+				changed.push_back(result);
+		}
+	}
+}
+
+uint32_t version_solver::resolve_conflict(uint32_t index) {
+	bool learned = false;
+
+	while (true) {
+		std::vector<term> terms = incompatibilities[index].terms;
+		if (terms.empty() || (terms.size() == 1
+				&& terms[0].package == root && is_positive(terms[0])))
+			throw std::runtime_error(explain(index));
+
+		// Term which was satisfied last decides where to backjump
+		size_t term_index = 0;
+		uint32_t satisfier = find_satisfier(terms[0]), previous_level = 1;
+		for (size_t i = 1; i < terms.size(); i++) {
+			uint32_t found = find_satisfier(terms[i]);
+			if (found > satisfier) {
+				previous_level = std::max(previous_level, assignments[satisfier].level);
+				satisfier = found;
+				term_index = i;
+			} else
+				previous_level = std::max(previous_level, assignments[found].level);
+		}
+
+		assignment found = assignments[satisfier];
+		// Part of the satisfier which the term doesn't need,
+		// its own satisfier also has to be kept
+		term difference = intersect(found.value, negate(terms[term_index]));
+		bool has_difference = !is_empty(difference);
+		if (has_difference) {
+			previous_level = std::max(previous_level,
+					assignments[find_satisfier(negate(difference))].level);
+		}
+
+		if (previous_level < found.level || found.cause == none) {
+			backtrack(previous_level);
+			if (learned)
+				attach(index);
+			return index;
+		}
+
+		// Satisfier was derived, so its cause and this incompatibility
+		// together imply one without the satisfier's package
+		incompatibility derived;
+		for (size_t i = 0; i < terms.size(); i++) {
+			if (i != term_index)
+				derived.terms.push_back(terms[i]);
+		}
+		for (auto &t : incompatibilities[found.cause].terms) {
+			if (t.package != found.value.package)
+				derived.terms.push_back(t);
+		}
+		if (has_difference)
+			derived.terms.push_back(negate(difference));
+
+		derived.cause = cause::derived;
+		derived.left = index;
+		derived.right = found.cause;
+		index = store(std::move(derived));
+		learned = true;
+		conflict_count++;
+	}
+}
+
+uint32_t version_solver::find_satisfier(const term &value) const {
+	auto &pkg = packages[value.package];
+	for (size_t i = 0; i < pkg.narrowed.size(); i++) {
+		if (satisfies(pkg.narrowed[i], value))
+			return pkg.assignments[i];
+	}
+
+	throw std::logic_error("Term of " + pkg.id + " has no satisfier.");
+}
+
+uint32_t version_solver::choose() {
+	// Package with the fewest releases left fails or succeeds fastest,
+	// ties go to packages found first, closer to the root
+	uint32_t best = none;
+	while (!candidates.empty()) {
+		auto [count, package] = candidates.top();
+		auto &pkg = packages[package];
+		if (pkg.decision == none && !pkg.narrowed.empty() && is_positive(pkg.narrowed.back())
+				&& pkg.narrowed.back().releases.count() == count) {
+			best = package;
+			break;
+		}
+		candidates.pop();
+	}
+
+	if (best == none)
+		return none;
+
+	// Narrowed positive terms are never empty, newest release wins
+	size_t release = packages[best].narrowed.back().releases.first();
+	auto added = packages[best].dependencies_added[release]
+			? std::vector<uint32_t>() : add_dependencies(best, release);
+
+	// Deciding would contradict dependencies, propagation finds out why
+	for (uint32_t index : added) {
+		auto &terms = incompatibilities[index].terms;
+		if (std::all_of(terms.begin(), terms.end(), [&](auto &t) {
+			return t.package == best || relate(t) == relation::satisfied;
+		}))
+			return best;
+	}
+
+	decide(best, release);
+	return best;
+}
+
+std::string version_solver::describe(const term &value) const {
+	auto &pkg = packages[value.package];
+	const release_set &set = value.releases;
+	size_t count = set.count();
+	if (value.package == root || set.full())
+		return pkg.id;
+
+	size_t first = set.first();
+	if (count == 1)
+		return pkg.id + ' ' + std::string(pkg.releases[first]);
+
+	size_t last = first + count - 1;
+	bool contiguous = true;
+	for (size_t i = first; i <= last && contiguous; i++)
+		contiguous = set.contains(i);
+
+	if (contiguous) {
+		std::string oldest(pkg.releases[last]), newest(pkg.releases[first]);
+		if (first == 0)
+			return pkg.id + " >=" + oldest;
+		if (last == pkg.releases.size() - 1)
+			return pkg.id + " <=" + newest;
+		return pkg.id + " >=" + oldest + " <=" + newest;
+	}
+
+	if (count > 4)
+		return pkg.id + " (" + std::to_string(count) + " releases)";
+
+	std::string result = pkg.id + ' ';
+	for (size_t i = first; i < pkg.releases.size(); i++) {
+		if (set.contains(i))
+			result += std::string(pkg.releases[i]) + (--count > 0 ? " || " : "");
+	}
+	return result;
+}
+
+std::string version_solver::describe(uint32_t index) const {
+	auto &value = incompatibilities[index];
+
+	switch (value.cause) {
+	case cause::root:
+		return packages[root].id + " is the project";
+	case cause::dependency: {
+		auto &pkg = packages[value.package];
+		auto &dependency = packages[value.dependency];
+		std::string result = (value.package == root ? pkg.id : pkg.id + ' '
+				+ std::string(pkg.releases[value.release])) + " depends on "
+				+ dependency.id + ' ' + std::string(value.range);
+
+		if (!dependency.manifest && value.dependency != root)
+			result += ", which wasn't found in any archive";
+		else if (value.terms.size() == 1)
+			result += ", which has no matching release";
+		return result;
+	}
+	case cause::same_name:
+		return describe(value.terms[0]) + " and " + describe(value.terms[1])
+				+ " share a name, only one of them can be installed";
+	default:
+		break;
+	}
+
+	std::vector<std::string> positive, negative;
+	for (auto &t : value.terms) {
+		if (is_positive(t))
+			positive.push_back(describe(t));
+		else
+			negative.push_back(describe(negate(t)));
+	}
+
+	auto join = [](const std::vector<std::string> &parts, std::string_view separator) {
+		std::string result;
+		for (auto &part : parts)
+			result += (result.empty() ? "" : std::string(separator)) + part;
+		return result;
+	};
+
+	if (positive.empty() && negative.empty())
+		return "no selection of releases works";
+	if (negative.empty()) {
+		if (positive.size() == 1 && value.terms[0].package == root)
+			return "dependencies of " + positive[0] + " can't be satisfied";
+		if (positive.size() == 1)
+			return positive[0] + " can't be installed";
+		return join(positive, " and ") + " can't be installed together";
+	}
+	if (positive.empty())
+		return join(negative, " or ") + " is required";
+	return join(positive, " and ") + " requires " + join(negative, " or ");
+}
+
+std::string version_solver::explain(uint32_t index) const {
+	std::string result = "Dependencies can't be resolved:\n";
+	if (incompatibilities[index].cause != cause::derived)
+		return result + describe(index) + ".\nPlease override this conflict with another top-level dependency.";
+
+	// Each learned incompatibility is one line, later ones refer to earlier ones
+	std::unordered_map<uint32_t, size_t> numbers;
+	std::vector<std::string> lines;
+
+	auto get_reason = [&](uint32_t cause) {
+		auto it = numbers.find(cause);
+		return describe(cause) + (it == numbers.end() ? "" : " (" + std::to_string(it->second) + ')');
+	};
+
+	std::function<void(uint32_t)> visit = [&](uint32_t current) {
+		auto &value = incompatibilities[current];
+		for (uint32_t cause : { value.left, value.right }) {
+			if (incompatibilities[cause].cause == cause::derived && !numbers.contains(cause))
+				visit(cause);
+		}
+
+		lines.push_back("Because " + get_reason(value.left) + " and "
+				+ get_reason(value.right) + ", " + describe(current) + '.');
+		numbers.emplace(current, lines.size());
+	};
+	visit(index);
+
+	for (size_t i = 0; i < lines.size(); i++)
+		result += '(' + std::to_string(i + 1) + ") " + lines[i] + '\n';
+	return result + "Please override this conflict with another top-level dependency.";
+}
+
+solution solve(const nl::json &package, manifest_source &source) {
+	return version_solver(package, source).solve();
+}
+
+}
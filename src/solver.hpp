@@ -0,0 +1,53 @@
+#pragma once
+
+#include "pch.hpp"
+
+#include "util/version_range.hpp"
+
+namespace solver {
+
+// Package the solver needs, with the first range it saw for it
+struct request {
+	std::string_view id;
+	const util::version_range *range;
+};
+
+// Gives manifests to the solver, it asks for each package ID once
+class manifest_source {
+public:
+	virtual ~manifest_source() = default;
+
+	// Manifests must stay valid until solving ends,
+	// nullptr if there's no package with that ID
+	virtual std::vector<const nlohmann::json *> load(const std::vector<request> &requests) = 0;
+
+	// Manifest lists only some releases of the package, so dependencies
+	// which match none of them conflict instead of being left out
+	virtual bool is_partial(std::string_view /* id */) const {
+		return false;
+	}
+};
+
+struct selection {
+	std::string id;
+	// Key in "releases" of the manifest
+	std::string release;
+	util::version version;
+};
+
+struct solution {
+	// In order of decisions, without the root
+	std::vector<selection> packages;
+	size_t decision_count = 0, conflict_count = 0;
+};
+
+// Selects one release of each needed package, so that every dependency
+// range is satisfied and no two packages share a name. Conflicts are
+// learned as incompatibilities, so the search never repeats them when
+// it backtracks. Dependencies of the root package override dependencies
+// of other packages on the same name, and dependencies of other packages
+// which match no release are left out. Throws with an explanation if
+// there is no such selection.
+solution solve(const nlohmann::json &package, manifest_source &source);
+
+}
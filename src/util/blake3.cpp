@@ -0,0 +1,330 @@
+#include "blake3.hpp"
+#include "blake3_kernels.hpp"
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace fs = std::filesystem;
+
+using namespace util::blake3_kernels;
+
+static constexpr uint32_t rotate_right(uint32_t value, int count) noexcept {
+	return (value >> count) | (value << (32 - count));
+}
+
+static void mix(std::array<uint32_t, 16> &state, size_t a, size_t b,
+		size_t c, size_t d, uint32_t x, uint32_t y) noexcept {
+	state[a] = state[a] + state[b] + x;
+	state[d] = rotate_right(state[d] ^ state[a], 16);
+	state[c] = state[c] + state[d];
+	state[b] = rotate_right(state[b] ^ state[c], 12);
+	state[a] = state[a] + state[b] + y;
+	state[d] = rotate_right(state[d] ^ state[a], 8);
+	state[c] = state[c] + state[d];
+	state[b] = rotate_right(state[b] ^ state[c], 7);
+}
+
+static std::array<uint32_t, 16> compress(const std::array<uint32_t, 8> &chaining_value,
+		const std::array<uint32_t, 16> &block_words, uint64_t counter,
+		uint32_t block_length, uint32_t flags) noexcept {
+	std::array<uint32_t, 16> state = {
+		chaining_value[0], chaining_value[1], chaining_value[2], chaining_value[3],
+		chaining_value[4], chaining_value[5], chaining_value[6], chaining_value[7],
+		iv[0], iv[1], iv[2], iv[3],
+		static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32),
+		block_length, flags
+	};
+	std::array<uint32_t, 16> message = block_words;
+
+	for (int round = 0; round < 7; round++) {
+		mix(state, 0, 4, 8, 12, message[0], message[1]);
+		mix(state, 1, 5, 9, 13, message[2], message[3]);
+		mix(state, 2, 6, 10, 14, message[4], message[5]);
+		mix(state, 3, 7, 11, 15, message[6], message[7]);
+
+		mix(state, 0, 5, 10, 15, message[8], message[9]);
+		mix(state, 1, 6, 11, 12, message[10], message[11]);
+		mix(state, 2, 7, 8, 13, message[12], message[13]);
+		mix(state, 3, 4, 9, 14, message[14], message[15]);
+
+		std::array<uint32_t, 16> permuted;
+		for (size_t i = 0; i < 16; i++)
+			permuted[i] = message[message_permutation[i]];
+		message = permuted;
+	}
+
+	for (size_t i = 0; i < 8; i++) {
+		state[i] ^= state[i + 8];
+		state[i + 8] ^= chaining_value[i];
+	}
+
+	return state;
+}
+
+static std::array<uint32_t, 16> get_block_words(const uint8_t *block) noexcept {
+	std::array<uint32_t, 16> words;
+	for (size_t i = 0; i < 16; i++) {
+		const uint8_t *bytes = block + i * 4;
+		words[i] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16)
+				| (static_cast<uint32_t>(bytes[3]) << 24);
+	}
+	return words;
+}
+
+// Chunks hashed at once, loops over lanes are independent
+// so compiler turns them into SIMD instructions of the baseline
+// instruction set, wider kernels are picked at runtime
+static constexpr size_t lane_count = 8;
+using lanes = std::array<uint32_t, lane_count>;
+
+static inline void mix_lanes(std::array<lanes, 16> &state, size_t a, size_t b,
+		size_t c, size_t d, const lanes &x, const lanes &y) noexcept {
+	for (size_t i = 0; i < lane_count; i++) {
+		state[a][i] = state[a][i] + state[b][i] + x[i];
+		state[d][i] = rotate_right(state[d][i] ^ state[a][i], 16);
+		state[c][i] = state[c][i] + state[d][i];
+		state[b][i] = rotate_right(state[b][i] ^ state[c][i], 12);
+		state[a][i] = state[a][i] + state[b][i] + y[i];
+		state[d][i] = rotate_right(state[d][i] ^ state[a][i], 8);
+		state[c][i] = state[c][i] + state[d][i];
+		state[b][i] = rotate_right(state[b][i] ^ state[c][i], 7);
+	}
+}
+
+// Chaining values of up to "lane_count" whole consecutive
+// chunks, none of which may be the root
+static void hash_chunks_portable(const uint8_t *input, size_t count,
+		uint64_t counter, chaining_value *values) noexcept {
+	std::array<lanes, 8> chaining_values;
+	for (size_t i = 0; i < 8; i++)
+		chaining_values[i].fill(iv[i]);
+
+	for (size_t block = 0; block < util::blake3::chunk_size / util::blake3::block_size; block++) {
+		std::array<lanes, 16> message{};
+		for (size_t lane = 0; lane < count; lane++) {
+			auto words = get_block_words(input + lane * util::blake3::chunk_size
+					+ block * util::blake3::block_size);
+			for (size_t i = 0; i < 16; i++)
+				message[i][lane] = words[i];
+		}
+
+		uint32_t flags = (block == 0 ? static_cast<uint32_t>(chunk_start) : 0u)
+				| (block == 15 ? static_cast<uint32_t>(chunk_end) : 0u);
+
+		std::array<lanes, 16> state;
+		for (size_t i = 0; i < 8; i++)
+			state[i] = chaining_values[i];
+		for (size_t i = 0; i < 4; i++)
+			state[i + 8].fill(iv[i]);
+		for (size_t lane = 0; lane < lane_count; lane++) {
+			state[12][lane] = static_cast<uint32_t>(counter + lane);
+			state[13][lane] = static_cast<uint32_t>((counter + lane) >> 32);
+		}
+		state[14].fill(util::blake3::block_size);
+		state[15].fill(flags);
+
+		for (auto &order : message_schedule) {
+			mix_lanes(state, 0, 4, 8, 12, message[order[0]], message[order[1]]);
+			mix_lanes(state, 1, 5, 9, 13, message[order[2]], message[order[3]]);
+			mix_lanes(state, 2, 6, 10, 14, message[order[4]], message[order[5]]);
+			mix_lanes(state, 3, 7, 11, 15, message[order[6]], message[order[7]]);
+
+			mix_lanes(state, 0, 5, 10, 15, message[order[8]], message[order[9]]);
+			mix_lanes(state, 1, 6, 11, 12, message[order[10]], message[order[11]]);
+			mix_lanes(state, 2, 7, 8, 13, message[order[12]], message[order[13]]);
+			mix_lanes(state, 3, 4, 9, 14, message[order[14]], message[order[15]]);
+		}
+
+		for (size_t i = 0; i < 8; i++) {
+			for (size_t lane = 0; lane < lane_count; lane++)
+				chaining_values[i][lane] = state[i][lane] ^ state[i + 8][lane];
+		}
+	}
+
+	for (size_t lane = 0; lane < count; lane++) {
+		for (size_t i = 0; i < 8; i++)
+			values[lane][i] = chaining_values[i][lane];
+	}
+}
+
+static bool has_avx2() noexcept {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+	static const bool supported = __builtin_cpu_supports("avx2");
+	return supported;
+#elif defined(_M_X64)
+	static const bool supported = [] {
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		// OS has to save YMM registers too
+		__cpuid(info, 1);
+		bool os_saves_ymm = (info[2] & (1 << 27)) != 0
+				&& (_xgetbv(0) & 0x6) == 0x6;
+
+		__cpuidex(info, 7, 0);
+		return os_saves_ymm && (info[1] & (1 << 5)) != 0;
+	}();
+	return supported;
+#else
+	return false;
+#endif
+}
+
+static void hash_chunks(const uint8_t *input, size_t count,
+		uint64_t counter, chaining_value *values) noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+	if (count == lane_count && has_avx2()) {
+		hash_8_chunks_avx2(input, counter, values);
+		return;
+	}
+#endif
+
+	hash_chunks_portable(input, count, counter, values);
+}
+
+namespace util {
+
+blake3::words blake3::output::get_chaining_value() const noexcept {
+	auto state = compress(chaining_value, block_words, counter, block_length, flags);
+
+	words words;
+	std::copy(state.begin(), state.begin() + 8, words.begin());
+	return words;
+}
+
+blake3::digest blake3::output::get_root_digest() const noexcept {
+	auto state = compress(chaining_value, block_words, 0, block_length, flags | root);
+
+	digest digest;
+	for (size_t i = 0; i < digest.size(); i++)
+		digest[i] = static_cast<uint8_t>(state[i / 4] >> (8 * (i % 4)));
+	return digest;
+}
+
+blake3::blake3() : chaining_value(iv) {
+	block.fill(0);
+}
+
+void blake3::update(std::span<const std::byte> data) {
+	auto ptr = reinterpret_cast<const uint8_t *>(data.data());
+	size_t size = data.size();
+
+	while (size != 0) {
+		// Chunk is only compressed once more data arrives,
+		// because the last one has to be marked as root
+		if (blocks_compressed * block_size + block_length == chunk_size) {
+			words value = get_chunk_output().get_chaining_value();
+			add_chunk_chaining_value(value, ++chunk_counter);
+
+			chaining_value = iv;
+			block.fill(0);
+			block_length = 0;
+			blocks_compressed = 0;
+		}
+
+		// Full block is compressed once more data arrives too
+		if (block_length == block_size) {
+			chaining_value = output{ chaining_value, get_block_words(block.data()),
+					chunk_counter, block_size, get_chunk_start_flag() }.get_chaining_value();
+			blocks_compressed++;
+			block.fill(0);
+			block_length = 0;
+		}
+
+		// Whole chunks followed by more data skip the buffer
+		if (blocks_compressed == 0 && block_length == 0 && size > chunk_size) {
+			size_t count = std::min((size - 1) / chunk_size, lane_count);
+
+			std::array<words, lane_count> values;
+			hash_chunks(ptr, count, chunk_counter, values.data());
+			for (size_t i = 0; i < count; i++)
+				add_chunk_chaining_value(values[i], ++chunk_counter);
+
+			ptr += count * chunk_size;
+			size -= count * chunk_size;
+			continue;
+		}
+
+		size_t count = std::min<size_t>(block_size - block_length, size);
+		std::copy(ptr, ptr + count, block.data() + block_length);
+		block_length += static_cast<uint32_t>(count);
+		ptr += count;
+		size -= count;
+	}
+}
+
+void blake3::update(std::string_view data) {
+	update(std::span<const std::byte>(reinterpret_cast<
+			const std::byte *>(data.data()), data.size()));
+}
+
+blake3::digest blake3::finalize() const {
+	output output = get_chunk_output();
+
+	for (auto it = stack.rbegin(); it != stack.rend(); it++) {
+		std::array<uint32_t, 16> block_words;
+		words right = output.get_chaining_value();
+		std::copy(it->begin(), it->end(), block_words.begin());
+		std::copy(right.begin(), right.end(), block_words.begin() + 8);
+
+		output = { iv, block_words, 0, block_size, parent };
+	}
+
+	return output.get_root_digest();
+}
+
+std::string blake3::to_string(const digest &digest) {
+	static constexpr char hex_digits[] = "0123456789abcdef";
+
+	std::string str;
+	str.reserve(digest.size() * 2);
+	for (uint8_t byte : digest) {
+		str.push_back(hex_digits[byte >> 4]);
+		str.push_back(hex_digits[byte & 0xf]);
+	}
+	return str;
+}
+
+blake3::digest blake3::hash_file(const fs::path &path) {
+	std::ifstream stream(path, std::ifstream::binary);
+	if (!stream)
+		throw std::runtime_error("Failed to open " + path.string() + '.');
+
+	blake3 hasher;
+	std::vector<char> buffer(64 * 1024);
+	while (stream) {
+		stream.read(buffer.data(), buffer.size());
+		hasher.update(std::string_view(buffer.data(), stream.gcount()));
+	}
+
+	return hasher.finalize();
+}
+
+uint32_t blake3::get_chunk_start_flag() const noexcept {
+	return blocks_compressed == 0 ? static_cast<uint32_t>(chunk_start) : 0u;
+}
+
+blake3::output blake3::get_chunk_output() const noexcept {
+	return { chaining_value, get_block_words(block.data()), chunk_counter,
+			block_length, get_chunk_start_flag() | chunk_end };
+}
+
+void blake3::add_chunk_chaining_value(words value, uint64_t total_chunks) {
+	// Number of trailing zero bits is the number of subtrees to merge
+	while ((total_chunks & 1) == 0) {
+		std::array<uint32_t, 16> block_words;
+		std::copy(stack.back().begin(), stack.back().end(), block_words.begin());
+		std::copy(value.begin(), value.end(), block_words.begin() + 8);
+		stack.pop_back();
+
+		value = output{ iv, block_words, 0, block_size, parent }.get_chaining_value();
+		total_chunks >>= 1;
+	}
+
+	stack.push_back(value);
+}
+
+}
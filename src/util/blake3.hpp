@@ -0,0 +1,57 @@
+#pragma once
+
+#include "pch.hpp"
+
+namespace util {
+
+// Incremental BLAKE3 hash with 256-bit output
+class blake3 {
+public:
+	using digest = std::array<uint8_t, 32>;
+
+	static constexpr size_t block_size = 64, chunk_size = 1024;
+
+	blake3();
+
+	void update(std::span<const std::byte> data);
+
+	void update(std::string_view data);
+
+	// Doesn't modify the state, more data may follow
+	digest finalize() const;
+
+	static std::string to_string(const digest &digest);
+
+	static digest hash_file(const std::filesystem::path &path);
+
+private:
+	using words = std::array<uint32_t, 8>;
+
+	struct output {
+		words chaining_value;
+		std::array<uint32_t, 16> block_words;
+		uint64_t counter;
+		uint32_t block_length, flags;
+
+		words get_chaining_value() const noexcept;
+
+		digest get_root_digest() const noexcept;
+	};
+
+	// State of the current chunk
+	words chaining_value;
+	uint64_t chunk_counter = 0;
+	std::array<uint8_t, block_size> block;
+	uint32_t block_length = 0, blocks_compressed = 0;
+
+	// Chaining values of complete subtrees
+	std::vector<words> stack;
+
+	uint32_t get_chunk_start_flag() const noexcept;
+
+	output get_chunk_output() const noexcept;
+
+	void add_chunk_chaining_value(words value, uint64_t total_chunks);
+};
+
+}
@@ -0,0 +1,127 @@
+// Compiled with AVX2 enabled, only called after checking CPU support
+#include "blake3_kernels.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include <immintrin.h>
+
+namespace {
+
+using namespace util::blake3_kernels;
+
+template<int count>
+inline __m256i rotate_right(__m256i value) noexcept {
+	return _mm256_or_si256(_mm256_srli_epi32(value, count),
+			_mm256_slli_epi32(value, 32 - count));
+}
+
+inline void mix(__m256i *state, size_t a, size_t b, size_t c,
+		size_t d, __m256i x, __m256i y) noexcept {
+	state[a] = _mm256_add_epi32(_mm256_add_epi32(state[a], state[b]), x);
+	state[d] = rotate_right<16>(_mm256_xor_si256(state[d], state[a]));
+	state[c] = _mm256_add_epi32(state[c], state[d]);
+	state[b] = rotate_right<12>(_mm256_xor_si256(state[b], state[c]));
+	state[a] = _mm256_add_epi32(_mm256_add_epi32(state[a], state[b]), y);
+	state[d] = rotate_right<8>(_mm256_xor_si256(state[d], state[a]));
+	state[c] = _mm256_add_epi32(state[c], state[d]);
+	state[b] = rotate_right<7>(_mm256_xor_si256(state[b], state[c]));
+}
+
+// Turns 8 words of each of 8 lanes into 8 vectors of one word for all lanes
+inline void transpose(__m256i *vectors) noexcept {
+	__m256i ab_low = _mm256_unpacklo_epi32(vectors[0], vectors[1]);
+	__m256i ab_high = _mm256_unpackhi_epi32(vectors[0], vectors[1]);
+	__m256i cd_low = _mm256_unpacklo_epi32(vectors[2], vectors[3]);
+	__m256i cd_high = _mm256_unpackhi_epi32(vectors[2], vectors[3]);
+	__m256i ef_low = _mm256_unpacklo_epi32(vectors[4], vectors[5]);
+	__m256i ef_high = _mm256_unpackhi_epi32(vectors[4], vectors[5]);
+	__m256i gh_low = _mm256_unpacklo_epi32(vectors[6], vectors[7]);
+	__m256i gh_high = _mm256_unpackhi_epi32(vectors[6], vectors[7]);
+
+	__m256i abcd_0 = _mm256_unpacklo_epi64(ab_low, cd_low);
+	__m256i abcd_1 = _mm256_unpackhi_epi64(ab_low, cd_low);
+	__m256i abcd_2 = _mm256_unpacklo_epi64(ab_high, cd_high);
+	__m256i abcd_3 = _mm256_unpackhi_epi64(ab_high, cd_high);
+	__m256i efgh_0 = _mm256_unpacklo_epi64(ef_low, gh_low);
+	__m256i efgh_1 = _mm256_unpackhi_epi64(ef_low, gh_low);
+	__m256i efgh_2 = _mm256_unpacklo_epi64(ef_high, gh_high);
+	__m256i efgh_3 = _mm256_unpackhi_epi64(ef_high, gh_high);
+
+	vectors[0] = _mm256_permute2x128_si256(abcd_0, efgh_0, 0x20);
+	vectors[1] = _mm256_permute2x128_si256(abcd_1, efgh_1, 0x20);
+	vectors[2] = _mm256_permute2x128_si256(abcd_2, efgh_2, 0x20);
+	vectors[3] = _mm256_permute2x128_si256(abcd_3, efgh_3, 0x20);
+	vectors[4] = _mm256_permute2x128_si256(abcd_0, efgh_0, 0x31);
+	vectors[5] = _mm256_permute2x128_si256(abcd_1, efgh_1, 0x31);
+	vectors[6] = _mm256_permute2x128_si256(abcd_2, efgh_2, 0x31);
+	vectors[7] = _mm256_permute2x128_si256(abcd_3, efgh_3, 0x31);
+}
+
+}
+
+namespace util::blake3_kernels {
+
+void hash_8_chunks_avx2(const uint8_t *input, uint64_t counter,
+		chaining_value *values) noexcept {
+	constexpr size_t chunk_size = 1024, block_size = 64;
+
+	__m256i chaining_values[8];
+	for (size_t i = 0; i < 8; i++)
+		chaining_values[i] = _mm256_set1_epi32(static_cast<int>(iv[i]));
+
+	alignas(32) uint32_t counter_low[8], counter_high[8];
+	for (size_t lane = 0; lane < 8; lane++) {
+		counter_low[lane] = static_cast<uint32_t>(counter + lane);
+		counter_high[lane] = static_cast<uint32_t>((counter + lane) >> 32);
+	}
+
+	for (size_t block = 0; block < chunk_size / block_size; block++) {
+		__m256i message[16];
+		for (size_t half = 0; half < 2; half++) {
+			for (size_t lane = 0; lane < 8; lane++) {
+				message[half * 8 + lane] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(
+						input + lane * chunk_size + block * block_size + half * 32));
+			}
+			transpose(message + half * 8);
+		}
+
+		uint32_t flags = (block == 0 ? static_cast<uint32_t>(chunk_start) : 0u)
+				| (block == chunk_size / block_size - 1 ? static_cast<uint32_t>(chunk_end) : 0u);
+
+		__m256i state[16];
+		for (size_t i = 0; i < 8; i++)
+			state[i] = chaining_values[i];
+		for (size_t i = 0; i < 4; i++)
+			state[i + 8] = _mm256_set1_epi32(static_cast<int>(iv[i]));
+		state[12] = _mm256_load_si256(reinterpret_cast<const __m256i *>(counter_low));
+		state[13] = _mm256_load_si256(reinterpret_cast<const __m256i *>(counter_high));
+		state[14] = _mm256_set1_epi32(static_cast<int>(block_size));
+		state[15] = _mm256_set1_epi32(static_cast<int>(flags));
+
+		for (auto &order : message_schedule) {
+			mix(state, 0, 4, 8, 12, message[order[0]], message[order[1]]);
+			mix(state, 1, 5, 9, 13, message[order[2]], message[order[3]]);
+			mix(state, 2, 6, 10, 14, message[order[4]], message[order[5]]);
+			mix(state, 3, 7, 11, 15, message[order[6]], message[order[7]]);
+
+			mix(state, 0, 5, 10, 15, message[order[8]], message[order[9]]);
+			mix(state, 1, 6, 11, 12, message[order[10]], message[order[11]]);
+			mix(state, 2, 7, 8, 13, message[order[12]], message[order[13]]);
+			mix(state, 3, 4, 9, 14, message[order[14]], message[order[15]]);
+		}
+
+		for (size_t i = 0; i < 8; i++)
+			chaining_values[i] = _mm256_xor_si256(state[i], state[i + 8]);
+	}
+
+	// Back from one word of each lane per vector to one lane per vector
+	transpose(chaining_values);
+	for (size_t lane = 0; lane < 8; lane++) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(
+				values[lane].data()), chaining_values[lane]);
+	}
+}
+
+}
+
+#endif
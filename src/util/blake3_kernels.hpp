@@ -0,0 +1,56 @@
+#pragma once
+
+// Kept off the precompiled header, inline functions from a translation
+// unit built for a wider instruction set could be picked by the linker
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Internals of util::blake3 shared with kernels
+// compiled for specific instruction sets
+namespace util::blake3_kernels {
+
+inline constexpr std::array<uint32_t, 8> iv = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+inline constexpr std::array<size_t, 16> message_permutation = {
+	2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8
+};
+
+// Message word order in each round, permutation applied ahead of time
+inline constexpr auto message_schedule = [] {
+	std::array<std::array<size_t, 16>, 7> schedule{};
+	std::array<size_t, 16> order{};
+	for (size_t i = 0; i < 16; i++)
+		order[i] = i;
+
+	for (auto &round : schedule) {
+		round = order;
+
+		std::array<size_t, 16> permuted{};
+		for (size_t i = 0; i < 16; i++)
+			permuted[i] = order[message_permutation[i]];
+		order = permuted;
+	}
+
+	return schedule;
+}();
+
+enum flag : uint32_t {
+	chunk_start = 1 << 0,
+	chunk_end = 1 << 1,
+	parent = 1 << 2,
+	root = 1 << 3
+};
+
+using chaining_value = std::array<uint32_t, 8>;
+
+#if defined(__x86_64__) || defined(_M_X64)
+// Chaining values of 8 whole consecutive chunks, none of which is the root
+void hash_8_chunks_avx2(const uint8_t *input, uint64_t counter,
+		chaining_value *values) noexcept;
+#endif
+
+}
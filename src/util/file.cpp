@@ -1,9 +1,159 @@
 #include "file.hpp"
 
 #include "util/http.hpp"
+#include "util/http_cache.hpp"
 #include "common.hpp"
 
 namespace fs = std::filesystem;
+using namespace util;
+
+// GET request state tied to its cache entry
+struct cached_download {
+	std::string url;
+	std::optional<http_cache::entry> entry;
+	std::optional<http_cache::writer> writer;
+	http::response response;
+	std::function<void(std::string_view)> on_data;
+
+	cached_download(std::string_view url,
+			std::function<void(std::string_view)> on_data)
+			: url(url), entry(http_cache::get().find(url)),
+			on_data(std::move(on_data)) {}
+};
+
+// Returns true if response was served without asking the server
+static bool serve_fresh(cached_download &download) {
+	auto &cache = http_cache::get();
+	if (!download.entry || !cache.is_fresh(*download.entry))
+		return false;
+
+	if (download.entry->status == 404)
+		throw http::error("Remote returned 404.");
+
+	cache.read_data(download.url, download.on_data);
+	return true;
+}
+
+static void prepare_request(http &request,
+		cached_download &download, const fs::path &cert_path) {
+	request.set_certificate(cert_path);
+	request.set_url(download.url);
+	if (download.entry)
+		http_cache::add_validators(request, *download.entry);
+
+	request.on_response([&download](const http::response &response) {
+		download.response = response;
+
+		if (response.status == 404)
+			http_cache::get().store_not_found(download.url);
+
+		if (response.status == 200)
+			download.writer.emplace(http_cache::get().begin_store(download.url, response));
+		else if (!(response.status == 304 && download.entry
+				&& download.entry->status == 200)) {
+			throw http::error("Remote returned " +
+					std::to_string(response.status) + ".");
+		}
+	});
+	request.on_data([&download](http::bytes data) {
+		std::string_view chunk(reinterpret_cast<
+				const char *>(data.data()), data.size());
+
+		download.writer->write(chunk);
+		download.on_data(chunk);
+	});
+}
+
+static void finish_download(cached_download &download) {
+	auto &cache = http_cache::get();
+
+	if (download.response.status == 304) {
+		cache.refresh(download.url, *download.entry, download.response);
+		cache.read_data(download.url, download.on_data);
+	} else
+		cache.store(download.url, *download.writer);
+}
+
+// Serves fresh URLs from the cache and downloads the rest concurrently.
+// "on_finish" may reject data of a URL by throwing. Last callback is
+// invoked for each URL once it's done, returning true cancels
+// everything which has not been completed yet.
+static std::vector<std::exception_ptr> perform_downloads(
+		const std::vector<std::string> &urls,
+		const std::function<void(size_t, std::string_view)> &on_data,
+		const std::function<void(size_t)> &on_finish,
+		std::chrono::milliseconds timeout,
+		const std::function<bool(size_t, const std::exception_ptr &)> &on_complete) {
+	std::vector<std::exception_ptr> errors(urls.size());
+	fs::path cert_path = common::getenv("VOLT_PATH") / fs::path("cacert.pem");
+
+	std::deque<cached_download> downloads;
+	std::deque<http> requests;
+	std::vector<size_t> request_indices;
+	http_batch batch;
+
+	bool done = false;
+	for (size_t i = 0; i < urls.size() && !done; i++) {
+		cached_download &download = downloads.emplace_back(urls[i],
+				[&on_data, i](std::string_view data) {
+			on_data(i, data);
+		});
+
+		try {
+			if (serve_fresh(download)) {
+				on_finish(i);
+				done = on_complete(i, errors[i]);
+				continue;
+			}
+		} catch (...) {
+			errors[i] = std::current_exception();
+			done = on_complete(i, errors[i]);
+			continue;
+		}
+
+		http &request = requests.emplace_back();
+		prepare_request(request, download, cert_path);
+		if (timeout.count() != 0)
+			request.set_transfer_timeout(timeout);
+
+		batch.add(request);
+		request_indices.push_back(i);
+	}
+
+	// Skip the network if cached responses were enough
+	if (done) {
+		for (size_t i = downloads.size(); i < urls.size(); i++)
+			errors[i] = std::make_exception_ptr(http::error("Request was cancelled."));
+		for (size_t index : request_indices)
+			errors[index] = std::make_exception_ptr(http::error("Request was cancelled."));
+		return errors;
+	}
+
+	batch.on_complete([&](size_t i, std::exception_ptr error) {
+		size_t index = request_indices[i];
+
+		try {
+			if (error)
+				std::rethrow_exception(error);
+
+			finish_download(downloads[index]);
+			on_finish(index);
+		} catch (...) {
+			errors[index] = std::current_exception();
+		}
+
+		return on_complete(index, errors[index]);
+	});
+
+	auto batch_errors = batch.perform();
+	for (size_t i = 0; i < request_indices.size(); i++) {
+		size_t index = request_indices[i];
+		if (!errors[index])
+			errors[index] = batch_errors[i];
+	}
+
+	return errors;
+}
 
 namespace util {
 
@@ -26,28 +176,97 @@ std::string read_file(const fs::path &path) {
 
 void write_file(const fs::path &path, std::string_view str) {
 	fs::create_directories(path.parent_path());
-	std::ofstream stream(path, std::ofstream::out);
-	stream << str;
+	fs::path tmp_path = get_tmp_path(path);
+
+	try {
+		{
+			std::ofstream stream(tmp_path, std::ofstream::out);
+			stream << str;
+			stream.close();
+
+			if (!stream)
+				throw std::runtime_error("Failed to write file:\n" + path.string());
+		}
+		fs::rename(tmp_path, path);
+	} catch (...) {
+		std::error_code error;
+		fs::remove(tmp_path, error);
+		throw;
+	}
+}
+
+fs::path get_tmp_path(const fs::path &path) {
+	fs::path tmp_path = path;
+	tmp_path += ".tmp" + std::to_string(std::random_device()());
+	return tmp_path;
 }
 
 std::string download(std::string_view url) {
 	std::string buffer;
+	download(url, [&buffer](std::string_view data) {
+		buffer += data;
+	});
+
+	return buffer;
+}
+
+void download(std::string_view url, const std::function<
+		void(std::string_view)> &on_data) {
+	cached_download download(url, on_data);
+	if (serve_fresh(download))
+		return;
 
 	http request;
-	request.set_certificate(common::getenv("VOLT_PATH") / fs::path("cacert.pem"));
-	request.set_url(url);
-	request.on_response([](const http::response &response) {
-		if (response.status != 200) {
-			throw http::error("Remote returned " +
-					std::to_string(response.status) + ".");
-		}
-	});
-	request.on_data([&buffer](const http::buffer &data) {
-		buffer.insert(buffer.end(), data.begin(), data.end());
-	});
+	prepare_request(request, download,
+			common::getenv("VOLT_PATH") / fs::path("cacert.pem"));
 	request.send();
+	finish_download(download);
+}
 
-	return buffer;
+std::vector<download_result> download_all(const std::vector<std::string> &urls) {
+	std::vector<download_result> results(urls.size());
+
+	auto errors = download_all(urls, [&results](size_t index, std::string_view data) {
+		results[index].data += data;
+	});
+
+	for (size_t i = 0; i < urls.size(); i++) {
+		if (errors[i]) {
+			results[i].data.clear();
+			results[i].error = errors[i];
+		}
+	}
+
+	return results;
+}
+
+std::vector<std::exception_ptr> download_all(const std::vector<std::string> &urls,
+		const std::function<void(size_t, std::string_view)> &on_data) {
+	return perform_downloads(urls, on_data, [](size_t) {}, std::chrono::milliseconds(0),
+			[](size_t, const std::exception_ptr &) { return false; });
+}
+
+std::vector<std::exception_ptr> download_first(const std::vector<std::string> &urls,
+		const std::function<void(size_t, std::string_view)> &on_data,
+		const std::function<void(size_t)> &on_finish,
+		std::chrono::milliseconds timeout) {
+	enum class state {
+		pending, failed, succeeded
+	};
+
+	std::vector<state> states(urls.size(), state::pending);
+
+	return perform_downloads(urls, on_data, on_finish, timeout,
+			[&states](size_t index, const std::exception_ptr &error) {
+		states[index] = error ? state::failed : state::succeeded;
+
+		// Done once everything before a success has failed
+		for (state state : states) {
+			if (state != state::failed)
+				return state == state::succeeded;
+		}
+		return true;
+	});
 }
 
 int32_t shell(std::string cmd, const std::function<void(std::string_view)>
@@ -6,10 +6,43 @@ namespace util {
 
 std::string read_file(const std::filesystem::path &path);
 
+// Writes a temporary file next to the target and renames it over, so
+// readers and concurrent writers never observe a partially written file
 void write_file(const std::filesystem::path &path, std::string_view str);
 
+// Unique path next to the given one for staging its replacement
+std::filesystem::path get_tmp_path(const std::filesystem::path &path);
+
 std::string download(std::string_view url);
 
+// Passes response body to the callback chunk by chunk
+void download(std::string_view url, const std::function<
+		void(std::string_view)> &on_data);
+
+struct download_result {
+	std::string data;
+	std::exception_ptr error;
+};
+
+// Downloads all URLs concurrently, results are in the same order
+std::vector<download_result> download_all(const std::vector<std::string> &urls);
+
+// Callback receives index of the URL, returns an exception
+// for each URL in the same order or nullptr on success
+std::vector<std::exception_ptr> download_all(const std::vector<std::string> &urls,
+		const std::function<void(size_t, std::string_view)> &on_data);
+
+// Downloads URLs concurrently, but only the first one in order that
+// succeeds matters. Once all URLs before it failed, the rest are
+// cancelled. "on_finish" is called once data of a URL is complete,
+// throwing from it fails that URL. Timeout applies to each transfer,
+// zero means none. Returns an exception for each URL, the first
+// nullptr is the winner.
+std::vector<std::exception_ptr> download_first(const std::vector<std::string> &urls,
+		const std::function<void(size_t, std::string_view)> &on_data,
+		const std::function<void(size_t)> &on_finish,
+		std::chrono::milliseconds timeout);
+
 int32_t shell(std::string cmd, const std::function<void(std::string_view)>
 		&stdout_cb, bool redirect_stderr = true, size_t buffer_capacity = 1024);
 
@@ -0,0 +1,67 @@
+#include "file_lock.hpp"
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <sys/file.h>
+	#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace util {
+
+file_lock::file_lock(const fs::path &path) : file_lock(path, nullptr) {}
+
+file_lock::file_lock(const fs::path &path, const std::function<void()> &on_wait) {
+	fs::create_directories(path.parent_path());
+
+#ifdef _WIN32
+	handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("Failed to open lock file:\n" + path.string());
+
+	OVERLAPPED overlapped{};
+	if (LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY,
+			0, MAXDWORD, MAXDWORD, &overlapped))
+		return;
+
+	if (on_wait)
+		on_wait();
+
+	if (!LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped)) {
+		CloseHandle(handle);
+		throw std::runtime_error("Failed to lock file:\n" + path.string());
+	}
+#else
+	fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd == -1)
+		throw std::runtime_error("Failed to open lock file:\n" + path.string());
+
+	if (::flock(fd, LOCK_EX | LOCK_NB) == 0)
+		return;
+
+	if (errno == EWOULDBLOCK && on_wait)
+		on_wait();
+
+	int result;
+	while ((result = ::flock(fd, LOCK_EX)) == -1 && errno == EINTR);
+
+	if (result == -1) {
+		::close(fd);
+		throw std::runtime_error("Failed to lock file:\n" + path.string());
+	}
+#endif
+}
+
+file_lock::~file_lock() {
+#ifdef _WIN32
+	// Closing the handle releases the lock
+	CloseHandle(handle);
+#else
+	::close(fd);
+#endif
+}
+
+}
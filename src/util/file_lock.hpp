@@ -0,0 +1,33 @@
+#pragma once
+
+#include "pch.hpp"
+
+namespace util {
+
+// Exclusive advisory lock on a file, held until destruction. Other
+// processes and other locks in this one on the same path wait for it.
+// The file is created if needed and never removed, because removing
+// it would let two processes lock different files of the same name.
+class file_lock {
+public:
+	file_lock(const std::filesystem::path &path);
+
+	// Callback is called once before waiting if the lock is already held
+	file_lock(const std::filesystem::path &path,
+			const std::function<void()> &on_wait);
+
+	file_lock(const file_lock &) = delete;
+
+	file_lock &operator=(const file_lock &) = delete;
+
+	~file_lock();
+
+private:
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	int fd;
+#endif
+};
+
+}
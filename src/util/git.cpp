@@ -0,0 +1,316 @@
+#include "git.hpp"
+
+#include "util/file.hpp"
+
+namespace fs = std::filesystem;
+
+template<typename T, void (*free_fn)(T *)>
+struct deleter {
+	void operator()(T *ptr) const noexcept {
+		free_fn(ptr);
+	}
+};
+
+using repository_ptr = std::unique_ptr<git_repository,
+		deleter<git_repository, git_repository_free>>;
+using remote_ptr = std::unique_ptr<git_remote,
+		deleter<git_remote, git_remote_free>>;
+using reference_ptr = std::unique_ptr<git_reference,
+		deleter<git_reference, git_reference_free>>;
+using object_ptr = std::unique_ptr<git_object,
+		deleter<git_object, git_object_free>>;
+
+static void ensure_initialized() {
+	static struct library {
+		library() {
+			git_libgit2_init();
+		}
+
+		~library() {
+			git_libgit2_shutdown();
+		}
+	} instance;
+}
+
+// Objects or references of the local repository are broken
+struct damaged_error : util::git::error {
+	using util::git::error::error;
+};
+
+static void check(int result, std::string_view action) {
+	if (result >= 0)
+		return;
+
+	const git_error *error = git_error_last();
+	std::string message = std::string(action) + ": "
+			+ (error ? error->message : "Unknown error") + '.';
+
+	// Network, authentication and missing references aren't local damage
+	if (error && (error->klass == GIT_ERROR_ODB || error->klass == GIT_ERROR_REPOSITORY
+			|| error->klass == GIT_ERROR_OBJECT || error->klass == GIT_ERROR_REFERENCE))
+		throw damaged_error(message);
+	throw util::git::error(message);
+}
+
+// Credentials are the usual cause of failing to reach a remote
+static void check_remote(int result, const std::string &url, std::string_view action) {
+	if (result == GIT_EAUTH) {
+		throw util::git::error("No valid credentials for " + url
+				+ ", add them to a git credential helper or an SSH agent.");
+	}
+	check(result, action);
+}
+
+static repository_ptr open_mirror(const fs::path &path) {
+	git_repository *repo;
+	if (fs::exists(path)) {
+		if (git_repository_open(&repo, path.string().c_str()) == 0)
+			return repository_ptr(repo);
+
+		// Unusable leftover, e.g. created by another git version
+		fs::remove_all(path);
+	}
+
+	fs::create_directories(path.parent_path());
+	check(git_repository_init(&repo, path.string().c_str(), true),
+			"Failed to create mirror " + path.string());
+	return repository_ptr(repo);
+}
+
+static reference_ptr find_reference(git_repository *repo, const std::string &name) {
+	git_reference *ref;
+	if (git_reference_lookup(&ref, repo, name.c_str()) == 0)
+		return reference_ptr(ref);
+	return nullptr;
+}
+
+struct fetch_payload {
+	util::git::transfer_progress progress;
+	const std::function<void(const util::git::transfer_progress &)> *on_progress;
+	// Download workers run in parallel, prompts would interleave
+	bool may_prompt = false;
+	// Each kind of credentials is offered once, then libgit2 gives up
+	bool tried_agent = false, tried_helper = false;
+};
+
+using credentials = std::optional<std::pair<std::string, std::string>>;
+
+// Username and password for the URL from credential helpers configured
+// for git. libgit2 can't run them, so this is the one place where git is
+// spawned. Prompts in the terminal if allowed and none of them knows it.
+static credentials run_credential_helpers(const char *url,
+		const char *username, bool may_prompt) {
+	std::string input = "url=" + std::string(url) + '\n';
+	if (username)
+		input += "username=" + std::string(username) + '\n';
+	input += '\n';
+
+	fs::path input_path = util::get_tmp_path(fs::temp_directory_path() / "volt-credential");
+	std::string output;
+	int32_t result;
+	try {
+		util::write_file(input_path, input);
+		std::string cmd = "git credential fill < \"" + input_path.string() + '"';
+		if (!may_prompt) {
+#ifdef _WIN32
+			cmd = "set GIT_TERMINAL_PROMPT=0&& " + cmd;
+#else
+			cmd = "GIT_TERMINAL_PROMPT=0 " + cmd;
+#endif
+		}
+
+		result = util::shell(cmd, [&output](std::string_view out) { output += out; }, false);
+	} catch (...) {
+		result = -1;
+	}
+
+	std::error_code error;
+	fs::remove(input_path, error);
+	if (result != 0)
+		return std::nullopt;
+
+	std::pair<std::string, std::string> filled;
+	std::istringstream stream(output);
+	for (std::string line; std::getline(stream, line);) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line.starts_with("username="))
+			filled.first = line.substr(9);
+		else if (line.starts_with("password="))
+			filled.second = line.substr(9);
+	}
+	return filled;
+}
+
+// Helpers run one at a time and once per URL, so concurrent
+// fetches of the same remote don't each spawn git and prompt
+static credentials fill_credentials(const char *url, const char *username, bool may_prompt) {
+	static std::mutex mutex;
+	static std::unordered_map<std::string, credentials> filled;
+
+	std::string key = std::string(username ? username : "") + '@' + url;
+	std::lock_guard lock(mutex);
+	// Asking without a prompt might have failed where a prompt succeeds
+	auto it = filled.find(key);
+	if (it == filled.end() || (!it->second && may_prompt))
+		it = filled.insert_or_assign(key, run_credential_helpers(url, username, may_prompt)).first;
+	return it->second;
+}
+
+// SSH keys come from the agent, passwords from git's credential helpers
+static int acquire_credentials(git_credential **out, const char *url,
+		const char *username_from_url, unsigned int allowed_types, void *ptr) {
+	auto &payload = *static_cast<fetch_payload *>(ptr);
+	const char *username = username_from_url ? username_from_url : "git";
+
+	if (allowed_types & GIT_CREDENTIAL_USERNAME)
+		return git_credential_username_new(out, username);
+
+	if ((allowed_types & GIT_CREDENTIAL_SSH_KEY) && !payload.tried_agent) {
+		payload.tried_agent = true;
+		return git_credential_ssh_key_from_agent(out, username);
+	}
+
+	if ((allowed_types & GIT_CREDENTIAL_USERPASS_PLAINTEXT) && !payload.tried_helper) {
+		payload.tried_helper = true;
+		if (auto filled = fill_credentials(url, username_from_url, payload.may_prompt)) {
+			return git_credential_userpass_plaintext_new(out,
+					filled->first.c_str(), filled->second.c_str());
+		}
+	}
+
+	return GIT_PASSTHROUGH;
+}
+
+static void fetch(git_repository *repo, const std::string &url,
+		const std::string &name, fetch_payload &payload) {
+	// Anonymous remote has no default refspecs which would fetch every branch
+	git_remote *remote_raw;
+	check(git_remote_create_anonymous(&remote_raw, repo, url.c_str()),
+			"Invalid repository URL " + url);
+	remote_ptr remote(remote_raw);
+
+	// Only one of them matches, mirror keeps tags and branches apart
+	std::string tag_spec = "+refs/tags/" + name + ":refs/volt/tags/" + name;
+	std::string head_spec = "+refs/heads/" + name + ":refs/volt/heads/" + name;
+	std::array<char *, 2> specs{ tag_spec.data(), head_spec.data() };
+	git_strarray refspecs{ specs.data(), specs.size() };
+
+	git_fetch_options options;
+	git_fetch_options_init(&options, GIT_FETCH_OPTIONS_VERSION);
+	options.download_tags = GIT_REMOTE_DOWNLOAD_TAGS_NONE;
+	options.update_fetchhead = false;
+#if LIBGIT2_VER_MAJOR > 1 || LIBGIT2_VER_MINOR >= 7
+	options.depth = 1;
+#else
+#pragma message("libgit2 older than 1.7 can't fetch shallow, mirrors will get whole history of each ref")
+#endif
+	options.callbacks.payload = &payload;
+	options.callbacks.credentials = acquire_credentials;
+	options.callbacks.transfer_progress = [](const git_indexer_progress *stats, void *ptr) {
+		auto &payload = *static_cast<fetch_payload *>(ptr);
+		payload.progress.received_objects = stats->received_objects;
+		payload.progress.total_objects = stats->total_objects;
+		payload.progress.received_bytes = stats->received_bytes;
+
+		if (*payload.on_progress)
+			(*payload.on_progress)(payload.progress);
+		return 0;
+	};
+
+	check_remote(git_remote_fetch(remote.get(), &refspecs, &options, nullptr),
+			url, "Failed to fetch " + name);
+}
+
+// Fetches the reference unless the mirror has it and checks it out
+static void export_from_mirror(git_repository *repo, const std::string &url,
+		const std::string &name, const fs::path &destination, fetch_payload &payload) {
+	reference_ptr ref = find_reference(repo, "refs/volt/tags/" + name);
+
+	if (!ref) {
+		fetch(repo, url, name, payload);
+
+		ref = find_reference(repo, "refs/volt/tags/" + name);
+		if (!ref)
+			ref = find_reference(repo, "refs/volt/heads/" + name);
+		if (!ref)
+			throw util::git::error("No tag or branch " + name + " in repository " + url + '.');
+	}
+
+	git_object *tree_raw;
+	check(git_reference_peel(&tree_raw, ref.get(), GIT_OBJECT_TREE),
+			"Failed to find files of " + name);
+	object_ptr tree(tree_raw);
+
+	std::string target = destination.string();
+	git_checkout_options options;
+	git_checkout_options_init(&options, GIT_CHECKOUT_OPTIONS_VERSION);
+	options.checkout_strategy = GIT_CHECKOUT_FORCE
+			| GIT_CHECKOUT_RECREATE_MISSING | GIT_CHECKOUT_DONT_UPDATE_INDEX;
+	options.target_directory = target.c_str();
+
+	fs::create_directories(destination);
+	check(git_checkout_tree(repo, tree.get(), &options),
+			"Failed to check out " + name);
+}
+
+namespace util::git {
+
+std::vector<std::string> list_remote_tags(const std::string &url) {
+	ensure_initialized();
+
+	git_remote *remote_raw;
+	check(git_remote_create_detached(&remote_raw, url.c_str()),
+			"Invalid repository URL " + url);
+	remote_ptr remote(remote_raw);
+
+	// Called on the main thread, so helpers may ask for the password
+	fetch_payload payload{ {}, nullptr, true };
+	git_remote_callbacks callbacks;
+	git_remote_init_callbacks(&callbacks, GIT_REMOTE_CALLBACKS_VERSION);
+	callbacks.payload = &payload;
+	callbacks.credentials = acquire_credentials;
+	check_remote(git_remote_connect(remote.get(), GIT_DIRECTION_FETCH,
+			&callbacks, nullptr, nullptr), url, "Could not connect to " + url);
+
+	const git_remote_head **heads;
+	size_t head_count;
+	check(git_remote_ls(&heads, &head_count, remote.get()),
+			"Could not list references of " + url);
+
+	static constexpr std::string_view prefix = "refs/tags/", peeled_suffix = "^{}";
+
+	std::vector<std::string> tags;
+	for (size_t i = 0; i < head_count; i++) {
+		std::string_view name = heads[i]->name;
+		if (name.starts_with(prefix) && !name.ends_with(peeled_suffix))
+			tags.emplace_back(name.substr(prefix.size()));
+	}
+	return tags;
+}
+
+transfer_progress export_ref(const fs::path &mirror_path,
+		const std::string &url, const std::string &name,
+		const fs::path &destination,
+		const std::function<void(const transfer_progress &)> &on_progress) {
+	ensure_initialized();
+
+	fetch_payload payload{ {}, &on_progress };
+	repository_ptr repo = open_mirror(mirror_path);
+
+	try {
+		export_from_mirror(repo.get(), url, name, destination, payload);
+	} catch (damaged_error &) {
+		// Retry once with a new mirror, other errors keep the objects fetched so far
+		repo.reset();
+		fs::remove_all(mirror_path);
+		repo = open_mirror(mirror_path);
+		payload.progress = {};
+		export_from_mirror(repo.get(), url, name, destination, payload);
+	}
+
+	return payload.progress;
+}
+
+}
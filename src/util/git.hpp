@@ -0,0 +1,27 @@
+#pragma once
+
+#include "pch.hpp"
+
+// Git operations done in-process with libgit2
+namespace util::git {
+
+using error = std::runtime_error;
+
+struct transfer_progress {
+	size_t received_objects = 0, total_objects = 0;
+	uint64_t received_bytes = 0;
+};
+
+// Names of tags in remote repository, without "refs/tags/"
+std::vector<std::string> list_remote_tags(const std::string &url);
+
+// Fetches a tag or branch into a bare mirror of the URL, creating it
+// if needed, then checks its files out into the destination without
+// any git metadata. Tags already in the mirror don't contact the remote.
+// Callback receives transfer progress, result is the final state.
+transfer_progress export_ref(const std::filesystem::path &mirror_path,
+		const std::string &url, const std::string &name,
+		const std::filesystem::path &destination,
+		const std::function<void(const transfer_progress &)> &on_progress = nullptr);
+
+}
@@ -2,15 +2,116 @@
 
 namespace fs = std::filesystem;
 
-static std::atomic_uint32_t handle_count = 0;
+// Process-wide pool of easy handles. All of them are attached
+// to a single share object, so connections, DNS lookups and
+// TLS sessions survive between consecutive requests.
+class handle_pool {
+public:
+	static handle_pool &get() {
+		static handle_pool pool;
+		return pool;
+	}
 
-namespace util {
+	CURL *acquire() {
+		CURL *handle = nullptr;
+		{
+			std::lock_guard lock(mutex);
+			if (!idle_handles.empty()) {
+				handle = idle_handles.back();
+				idle_handles.pop_back();
+			}
+		}
 
-http::http() {
-	if (handle_count++ == 0)
+		if (handle == nullptr)
+			handle = curl_easy_init();
+		else
+			curl_easy_reset(handle);
+
+		curl_easy_setopt(handle, CURLOPT_SHARE, share);
+		return handle;
+	}
+
+	void release(CURL *handle) {
+		std::lock_guard lock(mutex);
+		idle_handles.push_back(handle);
+	}
+
+private:
+	CURLSH *share;
+	std::vector<CURL *> idle_handles;
+	std::mutex mutex;
+	std::array<std::mutex, CURL_LOCK_DATA_LAST> share_mutexes;
+
+	handle_pool() {
 		curl_global_init(CURL_GLOBAL_DEFAULT);
 
-	handle = curl_easy_init();
+		share = curl_share_init();
+		curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lock_function);
+		curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlock_function);
+		curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+		curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+		curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	}
+
+	~handle_pool() {
+		// Handles must be detached from share before it's destroyed
+		for (CURL *handle : idle_handles)
+			curl_easy_cleanup(handle);
+
+		curl_share_cleanup(share);
+		curl_global_cleanup();
+	}
+
+	static void lock_function(CURL * /* handle */, curl_lock_data data,
+			curl_lock_access /* access */, void *userptr) {
+		static_cast<handle_pool *>(userptr)->share_mutexes[data].lock();
+	}
+
+	static void unlock_function(CURL * /* handle */,
+			curl_lock_data data, void *userptr) {
+		static_cast<handle_pool *>(userptr)->share_mutexes[data].unlock();
+	}
+};
+
+static std::atomic_uint32_t connections_created = 0, connections_reused = 0;
+
+static std::atomic_bool log_transfers = false;
+static std::vector<util::http::transfer_record> transfer_log;
+static std::mutex transfer_log_mutex;
+
+namespace util {
+
+std::optional<std::string_view> http::header_block::find(std::string_view name) const noexcept {
+	std::string_view remaining = lines;
+
+	while (!remaining.empty()) {
+		size_t end = std::min(remaining.find('\n'), remaining.size());
+		std::string_view line = remaining.substr(0, end);
+		remaining.remove_prefix(std::min(end + 1, remaining.size()));
+
+		size_t colon = line.find(':');
+		if (colon != name.size() || !std::equal(name.begin(), name.end(),
+				line.begin(), [](char a, char b) {
+			return std::tolower(static_cast<unsigned char>(a))
+					== std::tolower(static_cast<unsigned char>(b));
+		}))
+			continue;
+
+		std::string_view value = line.substr(colon + 1);
+		while (!value.empty() && std::isspace(static_cast<unsigned char>(value.front())))
+			value.remove_prefix(1);
+		while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back())))
+			value.remove_suffix(1);
+
+		return value;
+	}
+
+	return std::nullopt;
+}
+
+http::http() {
+	handle = handle_pool::get().acquire();
 	
 	curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, curl_write_function);
 	curl_easy_setopt(handle, CURLOPT_WRITEDATA, this);
@@ -21,32 +122,15 @@ http::http() {
 	static const std::string agent = std::string("curl/")
 			+ curl_version_info(CURLVERSION_NOW)->version;
 	curl_easy_setopt(handle, CURLOPT_USERAGENT, agent.c_str());
-
-	tmp_buffer.reserve(buffer_size);
 }
 
 http::~http() {
-	curl_easy_cleanup(handle);
-
-	if (--handle_count == 0)
-		curl_global_cleanup();
+	handle_pool::get().release(handle);
 }
 
 void http::send() {
-	curl_slist *curl_header = nullptr;
-	for (auto &header : request_headers) {
-		std::string str = header.first + ": " + header.second;
-		curl_header = curl_slist_append(curl_header, str.c_str());
-	}
-	curl_easy_setopt(handle, CURLOPT_HTTPHEADER, curl_header);
-
-	CURLcode curl_code = curl_easy_perform(handle);
-
-	finish_response();
-	tmp_response = response();
-
-	if (curl_code != CURLE_OK)
-		throw http::error(curl_easy_strerror(curl_code) + std::string("."));
+	begin_transfer();
+	end_transfer(curl_easy_perform(handle));
 }
 
 void http::set_version(http::version version) {
@@ -81,27 +165,44 @@ void http::set_timeout(const std::chrono::seconds &duration) {
 	curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, duration.count());
 }
 
+void http::set_follow_redirects(bool follow) {
+	curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, follow ? 1L : 0L);
+	curl_easy_setopt(handle, CURLOPT_MAXREDIRS, 10L);
+}
+
+void http::set_transfer_timeout(const std::chrono::milliseconds &duration) {
+	curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, static_cast<long>(duration.count()));
+}
+
 void http::on_response(std::function<void(const response &)> &&callback) noexcept {
 	response_callback = std::move(callback);
 }
 
 void http::on_data(std::function<void(const buffer &)> &&callback) noexcept {
+	tmp_buffer.reserve(buffer_size);
+	data_callback = [this, callback = std::move(callback)](bytes data) {
+		auto ptr = reinterpret_cast<const uint8_t *>(data.data());
+		tmp_buffer.assign(ptr, ptr + data.size());
+		callback(tmp_buffer);
+	};
+}
+
+void http::on_data(std::function<void(bytes)> &&callback) noexcept {
 	data_callback = std::move(callback);
 }
 
 size_t http::curl_header_function(char *buffer, size_t size, size_t nitems, void *userdata) {
 	size_t actual_size = size * nitems;
 	http *http = static_cast<util::http *>(userdata);
+	std::string &lines = http->tmp_response.headers.lines;
 
-	std::string line(buffer, actual_size);
-	size_t index = line.find(": ");
-
-	if (index != std::string::npos) {
-		std::string name = line.substr(0, index);
-		std::string value = line.substr(index + 2, line.size() - index - 4);
+	std::string_view line(buffer, actual_size);
 
-		http->tmp_response.headers[name] = value;
-	}
+	// Status line begins headers of another response (redirect, 100 Continue)
+	if (line.starts_with("HTTP/"))
+		lines.clear();
+	else if (line != "\r\n")
+		lines += line;
 
 	return actual_size;
 }
@@ -110,16 +211,39 @@ size_t http::curl_write_function(char *ptr, size_t size, size_t nmemb, void *use
 	size_t actual_size = size * nmemb;
 
 	http &request = *static_cast<util::http *>(userdata);
-	request.finish_response();
 
-	if (request.data_callback.has_value()) {
-		request.tmp_buffer.assign(ptr, ptr + actual_size);
-		request.data_callback.value()(request.tmp_buffer);
+	try {
+		request.finish_response();
+
+		if (request.data_callback.has_value()) {
+			request.data_callback.value()(bytes(
+					reinterpret_cast<const std::byte *>(ptr), actual_size));
+		}
+	} catch (...) {
+		request.callback_exception = std::current_exception();
+		return 0; // Aborts the transfer
 	}
 
 	return actual_size;
 }
 
+const http::response &http::get_response() const noexcept {
+	return last_response;
+}
+
+http::connection_stats http::get_connection_stats() noexcept {
+	return { connections_created, connections_reused };
+}
+
+void http::set_log_transfers(bool log) noexcept {
+	log_transfers = log;
+}
+
+std::vector<http::transfer_record> http::get_transfer_log() {
+	std::lock_guard lock(transfer_log_mutex);
+	return transfer_log;
+}
+
 void http::finish_response() {
 	if (tmp_response.status == -1) {
 		long response_code;
@@ -127,6 +251,7 @@ void http::finish_response() {
 
 		if (response_code != 0) {
 			tmp_response.status = response_code;
+			read_timings();
 
 			if (response_callback.has_value())
 				response_callback.value()(tmp_response);
@@ -134,4 +259,172 @@ void http::finish_response() {
 	}
 }
 
+void http::read_timings() {
+	auto get_time = [this](CURLINFO info) {
+		curl_off_t value = 0;
+		curl_easy_getinfo(handle, info, &value);
+		return std::chrono::microseconds(value);
+	};
+
+	timing_info &timings = tmp_response.timings;
+	timings.name_lookup = get_time(CURLINFO_NAMELOOKUP_TIME_T);
+	timings.connect = get_time(CURLINFO_CONNECT_TIME_T);
+	timings.app_connect = get_time(CURLINFO_APPCONNECT_TIME_T);
+	timings.start_transfer = get_time(CURLINFO_STARTTRANSFER_TIME_T);
+	timings.total = get_time(CURLINFO_TOTAL_TIME_T);
+
+	curl_off_t value = 0;
+	curl_easy_getinfo(handle, CURLINFO_SIZE_DOWNLOAD_T, &value);
+	timings.bytes_received = value;
+	curl_easy_getinfo(handle, CURLINFO_SPEED_DOWNLOAD_T, &value);
+	timings.bytes_per_second = value;
+}
+
+void http::begin_transfer() {
+	for (auto &header : request_headers) {
+		std::string str = header.first + ": " + header.second;
+		header_list = curl_slist_append(header_list, str.c_str());
+	}
+	curl_easy_setopt(handle, CURLOPT_HTTPHEADER, header_list);
+}
+
+void http::end_transfer(CURLcode curl_code) {
+	curl_easy_setopt(handle, CURLOPT_HTTPHEADER, nullptr);
+	curl_slist_free_all(header_list);
+	header_list = nullptr;
+
+	long new_connections = 0, response_code = 0;
+	curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &new_connections);
+	curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response_code);
+	if (new_connections != 0)
+		connections_created += new_connections;
+	else if (response_code != 0)
+		connections_reused++;
+
+	// Exceptions can't propagate through cURL, so
+	// callbacks abort the transfer and we rethrow here
+	std::exception_ptr exception = std::exchange(callback_exception, nullptr);
+	try {
+		if (!exception)
+			finish_response();
+	} catch (...) {
+		exception = std::current_exception();
+	}
+
+	if (response_code != 0)
+		tmp_response.status = response_code;
+	read_timings();
+	if (log_transfers) {
+		std::lock_guard lock(transfer_log_mutex);
+		transfer_log.push_back({
+			method.empty() ? (body.empty() ? "GET" : "POST") : method,
+			url, static_cast<int32_t>(response_code), tmp_response.timings
+		});
+	}
+
+	last_response = tmp_response;
+	tmp_response.status = -1;
+	tmp_response.headers.lines.clear();
+
+	if (exception)
+		std::rethrow_exception(exception);
+
+	if (curl_code != CURLE_OK)
+		throw http::error(curl_easy_strerror(curl_code) + std::string("."));
+}
+
+http_batch::http_batch() {
+	handle_pool::get(); // Initializes cURL
+	handle = curl_multi_init();
+	set_host_limit(default_host_limit);
+}
+
+http_batch::~http_batch() {
+	curl_multi_cleanup(handle);
+}
+
+void http_batch::add(http &request) {
+	requests.push_back(&request);
+}
+
+void http_batch::set_host_limit(uint32_t limit) {
+	curl_multi_setopt(handle, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(limit));
+}
+
+void http_batch::on_complete(std::function<
+		bool(size_t, std::exception_ptr)> &&callback) noexcept {
+	complete_callback = std::move(callback);
+}
+
+std::vector<std::exception_ptr> http_batch::perform() {
+	std::vector<std::exception_ptr> errors(requests.size());
+	std::unordered_map<CURL *, size_t> indices;
+
+	for (size_t i = 0; i < requests.size(); i++) {
+		http &request = *requests[i];
+		request.begin_transfer();
+		indices[request.handle] = i;
+		curl_multi_add_handle(handle, request.handle);
+	}
+
+	auto abort = [this, &indices, &errors](std::string_view reason) {
+		for (auto &item : indices) {
+			curl_multi_remove_handle(handle, item.first);
+			try {
+				requests[item.second]->end_transfer(CURLE_ABORTED_BY_CALLBACK);
+			} catch (...) {}
+			errors[item.second] = std::make_exception_ptr(http::error(std::string(reason)));
+		}
+		indices.clear();
+	};
+
+	int running = 1;
+	while (running != 0) {
+		CURLMcode multi_code = curl_multi_perform(handle, &running);
+		if (multi_code == CURLM_OK && running != 0)
+			multi_code = curl_multi_poll(handle, nullptr, 0, 1000, nullptr);
+
+		if (multi_code != CURLM_OK) {
+			// Fail whatever is still in flight
+			abort(curl_multi_strerror(multi_code) + std::string("."));
+			break;
+		}
+
+		bool cancel = false;
+		int queued;
+		while (CURLMsg *msg = curl_multi_info_read(handle, &queued)) {
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+
+			CURL *easy_handle = msg->easy_handle;
+			CURLcode curl_code = msg->data.result;
+			size_t i = indices[easy_handle];
+			indices.erase(easy_handle);
+			curl_multi_remove_handle(handle, easy_handle);
+
+			try {
+				requests[i]->end_transfer(curl_code);
+			} catch (...) {
+				errors[i] = std::current_exception();
+			}
+
+			if (complete_callback.has_value() && !cancel) {
+				try {
+					cancel = complete_callback.value()(i, errors[i]);
+				} catch (...) {
+					errors[i] = std::current_exception();
+				}
+			}
+		}
+
+		if (cancel) {
+			abort("Request was cancelled.");
+			break;
+		}
+	}
+
+	requests.clear();
+	return errors;
+}
+
 }
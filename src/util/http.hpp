@@ -8,6 +8,7 @@ class http {
 public:
 	using header_map = std::unordered_map<std::string, std::string>;
 	using buffer = std::vector<uint8_t>;
+	using bytes = std::span<const std::byte>;
 	using error = std::runtime_error;
 
 	enum class version : long {
@@ -27,17 +28,54 @@ public:
 		        options[] = "OPTIONS";
 	};
 
+	// Received header lines kept in a single buffer.
+	// Names are looked up case-insensitively.
+	class header_block {
+	public:
+		std::optional<std::string_view> find(std::string_view name) const noexcept;
+
+	private:
+		friend class http;
+
+		std::string lines;
+	};
+
+	// Points in time measured from the start of a transfer,
+	// only complete once the transfer has finished
+	struct timing_info {
+		std::chrono::microseconds name_lookup{ 0 }, connect{ 0 },
+				app_connect{ 0 }, start_transfer{ 0 }, total{ 0 };
+		uint64_t bytes_received = 0, bytes_per_second = 0;
+	};
+
 	struct response {
 		int32_t status = -1;
-		header_map headers;
+		header_block headers;
+		timing_info timings;
+	};
+
+	// Finished transfer as recorded in the process-wide log
+	struct transfer_record {
+		std::string method, url;
+		int32_t status;
+		timing_info timings;
+	};
+
+	// Transfers served over a pooled connection vs. newly opened ones
+	struct connection_stats {
+		uint32_t created = 0, reused = 0;
 	};
 
 	static constexpr uint32_t buffer_size = 16 * 1024;
 
 	http();
 
+	http(const http &other) = delete;
+
 	~http();
 
+	http &operator=(const http &other) = delete;
+
 	void send();
 
 	void set_version(version version);
@@ -56,27 +94,94 @@ public:
 
 	void set_timeout(const std::chrono::seconds &duration);
 
+	void set_follow_redirects(bool follow);
+
+	// Limits the whole transfer, not just connecting
+	void set_transfer_timeout(const std::chrono::milliseconds &duration);
+
 	void on_response(std::function<void(const response &)> &&callback) noexcept;
 
 	void on_data(std::function<void(const buffer &)> &&callback) noexcept;
 
+	// Data points directly into cURL's buffer and
+	// is only valid until the callback returns
+	void on_data(std::function<void(bytes)> &&callback) noexcept;
+
+	// Response of the last finished transfer
+	const response &get_response() const noexcept;
+
+	static connection_stats get_connection_stats() noexcept;
+
+	// Transfers are only logged once enabled, for "--timings"
+	static void set_log_transfers(bool log) noexcept;
+
+	// Every transfer this process has made since logging was
+	// enabled, in order of completion
+	static std::vector<transfer_record> get_transfer_log();
+
 private:
+	friend class http_batch;
+
 	CURL *handle;
+	curl_slist *header_list = nullptr;
 	header_map request_headers;
 	// cURL keeps pointers to these
 	std::string certificate, method, url, body;
 
 	std::optional<std::function<void(const response &)>> response_callback;
-	std::optional<std::function<void(const buffer &)>> data_callback;
+	std::optional<std::function<void(bytes)>> data_callback;
 
-	response tmp_response;
+	response tmp_response, last_response;
 	buffer tmp_buffer;
+	std::exception_ptr callback_exception;
 
 	static size_t curl_header_function(char *buffer, size_t size, size_t nitems, void *userdata);
 
 	static size_t curl_write_function(char *ptr, size_t size, size_t nmemb, void *userdata);
 
 	void finish_response();
+
+	void read_timings();
+
+	void begin_transfer();
+
+	// Rethrows callback exceptions and transfer errors
+	void end_transfer(CURLcode curl_code);
+};
+
+// Performs many requests concurrently on a single cURL multi
+// event loop. Requests must outlive the call to perform().
+class http_batch {
+public:
+	static constexpr uint32_t default_host_limit = 6;
+
+	http_batch();
+
+	http_batch(const http_batch &other) = delete;
+
+	~http_batch();
+
+	http_batch &operator=(const http_batch &other) = delete;
+
+	void add(http &request);
+
+	// Maximum number of simultaneous connections to a single host,
+	// zero means unlimited. Excess requests wait in a queue.
+	void set_host_limit(uint32_t limit);
+
+	// Called for each request as soon as it finishes, with an
+	// exception or nullptr. Returning true cancels all requests
+	// which are still in progress.
+	void on_complete(std::function<bool(size_t, std::exception_ptr)> &&callback) noexcept;
+
+	// Returns an exception for each request in order of
+	// addition, or nullptr if that request succeeded.
+	std::vector<std::exception_ptr> perform();
+
+private:
+	CURLM *handle;
+	std::vector<http *> requests;
+	std::optional<std::function<bool(size_t, std::exception_ptr)>> complete_callback;
 };
 
 }
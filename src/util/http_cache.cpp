@@ -0,0 +1,203 @@
+#include "http_cache.hpp"
+
+#include "util/file.hpp"
+#include "common.hpp"
+
+namespace fs = std::filesystem;
+namespace nl = nlohmann;
+
+static std::atomic_bool revalidate_fresh = false;
+
+namespace util {
+
+http_cache::writer::~writer() {
+	if (stream.is_open()) {
+		stream.close();
+
+		std::error_code error;
+		fs::remove(tmp_path, error);
+	}
+}
+
+void http_cache::writer::write(std::string_view data) {
+	stream.write(data.data(), data.size());
+}
+
+http_cache::http_cache(fs::path path,
+		std::chrono::seconds ttl,
+		std::chrono::seconds not_found_ttl)
+		: path(std::move(path)), ttl(ttl), not_found_ttl(not_found_ttl) {
+	fs::create_directories(this->path);
+}
+
+http_cache &http_cache::get() {
+	static http_cache cache = [] {
+		fs::path volt_path = common::getenv("VOLT_PATH");
+		nl::json config = nl::json::parse(util::read_file(volt_path / "config.json"));
+
+		std::chrono::seconds ttl = default_ttl;
+		std::chrono::seconds not_found_ttl = default_not_found_ttl;
+
+		if (config.contains("httpCache")) {
+			auto &settings = config["httpCache"];
+			if (settings.contains("ttl"))
+				ttl = std::chrono::seconds(settings["ttl"].get<int64_t>());
+			if (settings.contains("notFoundTtl"))
+				not_found_ttl = std::chrono::seconds(settings["notFoundTtl"].get<int64_t>());
+		}
+
+		return http_cache(volt_path / "cache" / "http", ttl, not_found_ttl);
+	}();
+
+	return cache;
+}
+
+std::optional<http_cache::entry> http_cache::find(std::string_view url) const {
+	std::ifstream stream(get_entry_path(url), std::ifstream::binary);
+	std::string header;
+	if (!std::getline(stream, header))
+		return std::nullopt;
+
+	try {
+		nl::json json = nl::json::parse(header);
+
+		// Different URL with the same hash
+		if (json["url"] != url)
+			return std::nullopt;
+
+		entry entry;
+		entry.status = json["status"];
+		entry.etag = json["etag"];
+		entry.last_modified = json["lastModified"];
+		entry.time = std::chrono::system_clock::time_point(
+				std::chrono::milliseconds(json["time"].get<int64_t>()));
+		return entry;
+	} catch (...) {
+		return std::nullopt;
+	}
+}
+
+bool http_cache::is_fresh(const entry &entry) const noexcept {
+	if (revalidate_fresh)
+		return false;
+
+	auto age = std::chrono::system_clock::now() - entry.time;
+	return age < (entry.status == 404 ? not_found_ttl : ttl);
+}
+
+void http_cache::read_data(std::string_view url, const std::function<
+		void(std::string_view)> &callback) const {
+	std::ifstream stream(get_entry_path(url), std::ifstream::binary);
+	std::string header;
+	if (!std::getline(stream, header))
+		throw std::runtime_error("Cached response is missing.");
+
+	std::vector<char> buffer(http::buffer_size);
+	while (stream) {
+		stream.read(buffer.data(), buffer.size());
+		if (stream.gcount() != 0)
+			callback(std::string_view(buffer.data(), stream.gcount()));
+	}
+}
+
+http_cache::writer http_cache::begin_store(std::string_view url,
+		const http::response &response) const {
+	entry entry;
+	entry.status = response.status;
+	entry.etag = response.headers.find("etag").value_or("");
+	entry.last_modified = response.headers.find("last-modified").value_or("");
+	entry.time = std::chrono::system_clock::now();
+
+	writer writer;
+	writer.tmp_path = get_tmp_path(get_entry_path(url));
+	writer.stream.open(writer.tmp_path, std::ofstream::binary);
+	writer.stream << get_header(url, entry);
+	return writer;
+}
+
+void http_cache::store(std::string_view url, writer &writer) {
+	writer.stream.close();
+
+	std::error_code error;
+	if (writer.stream)
+		fs::rename(writer.tmp_path, get_entry_path(url), error);
+
+	if (!writer.stream || error) {
+		fs::remove(writer.tmp_path, error);
+		throw std::runtime_error("Failed to cache response of:\n" + std::string(url));
+	}
+}
+
+void http_cache::refresh(std::string_view url, entry entry,
+		const http::response &response) {
+	if (auto etag = response.headers.find("etag"))
+		entry.etag = *etag;
+	if (auto last_modified = response.headers.find("last-modified"))
+		entry.last_modified = *last_modified;
+	entry.time = std::chrono::system_clock::now();
+
+	// Body is copied under the new header
+	writer writer;
+	writer.tmp_path = get_tmp_path(get_entry_path(url));
+	writer.stream.open(writer.tmp_path, std::ofstream::binary);
+	writer.stream << get_header(url, entry);
+	read_data(url, [&writer](std::string_view data) {
+		writer.write(data);
+	});
+	store(url, writer);
+}
+
+void http_cache::store_not_found(std::string_view url) {
+	entry entry;
+	entry.status = 404;
+	entry.time = std::chrono::system_clock::now();
+
+	write_file(get_entry_path(url), get_header(url, entry));
+}
+
+void http_cache::invalidate(std::string_view url) {
+	std::error_code error;
+	fs::remove(get_entry_path(url), error);
+}
+
+void http_cache::set_revalidate_fresh(bool revalidate) noexcept {
+	revalidate_fresh = revalidate;
+}
+
+void http_cache::add_validators(http &request, const entry &entry) {
+	if (entry.status != 200)
+		return;
+
+	if (!entry.etag.empty())
+		request.set_header("If-None-Match", entry.etag);
+	if (!entry.last_modified.empty())
+		request.set_header("If-Modified-Since", entry.last_modified);
+}
+
+fs::path http_cache::get_entry_path(std::string_view url) const {
+	// 64-bit FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : url) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ull;
+	}
+
+	std::stringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return path / ss.str();
+}
+
+std::string http_cache::get_header(std::string_view url, const entry &entry) {
+	nl::json json;
+	json["url"] = url;
+	json["status"] = entry.status;
+	json["etag"] = entry.etag;
+	json["lastModified"] = entry.last_modified;
+	json["time"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+			entry.time.time_since_epoch()).count();
+
+	// Escaped strings have no line breaks
+	return json.dump() + '\n';
+}
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "pch.hpp"
+
+#include "util/http.hpp"
+
+namespace util {
+
+// Persistent cache of GET responses keyed by URL. Each entry keeps
+// its validators, so a stale entry costs one conditional request.
+// Not found responses are cached too, for a separate duration.
+// Status and validators are the first line of the file with the body,
+// so replacing the file swaps both at once.
+class http_cache {
+public:
+	struct entry {
+		int32_t status = -1;
+		std::string etag, last_modified;
+		std::chrono::system_clock::time_point time;
+	};
+
+	// Streams response body into the cache
+	class writer {
+	public:
+		writer() = default;
+
+		writer(writer &&other) = default;
+
+		// Discards data unless it was stored
+		~writer();
+
+		void write(std::string_view data);
+
+	private:
+		friend class http_cache;
+
+		std::filesystem::path tmp_path;
+		std::ofstream stream;
+	};
+
+	static constexpr std::chrono::seconds default_ttl{ 60 };
+	static constexpr std::chrono::seconds default_not_found_ttl{ 60 };
+
+	http_cache(std::filesystem::path path,
+			std::chrono::seconds ttl,
+			std::chrono::seconds not_found_ttl);
+
+	// Cache at "$VOLT_PATH/cache/http/", durations are
+	// read from "httpCache" object in "config.json"
+	static http_cache &get();
+
+	std::optional<entry> find(std::string_view url) const;
+
+	// Fresh entries can be used without asking the server
+	bool is_fresh(const entry &entry) const noexcept;
+
+	void read_data(std::string_view url, const std::function<
+			void(std::string_view)> &callback) const;
+
+	writer begin_store(std::string_view url, const http::response &response) const;
+
+	void store(std::string_view url, writer &writer);
+
+	// Called when server responded with 304
+	void refresh(std::string_view url, entry entry,
+			const http::response &response);
+
+	void store_not_found(std::string_view url);
+
+	// Next request of the URL asks the server, e.g. after it was changed
+	void invalidate(std::string_view url);
+
+	// Fresh entries are revalidated too, for "--refresh"
+	static void set_revalidate_fresh(bool revalidate) noexcept;
+
+	// Sets If-None-Match and If-Modified-Since
+	static void add_validators(http &request, const entry &entry);
+
+private:
+	std::filesystem::path path;
+	std::chrono::seconds ttl, not_found_ttl;
+
+	std::filesystem::path get_entry_path(std::string_view url) const;
+
+	static std::string get_header(std::string_view url, const entry &entry);
+};
+
+}
@@ -0,0 +1,41 @@
+#include "integrity.hpp"
+
+#include "util/blake3.hpp"
+#include "util/parallel.hpp"
+
+namespace fs = std::filesystem;
+
+namespace util {
+
+file_hashes hash_directory(const fs::path &directory, size_t thread_count) {
+	std::vector<fs::path> files;
+	for (auto &entry : fs::recursive_directory_iterator(directory)) {
+		if (fs::is_regular_file(entry.symlink_status()))
+			files.push_back(entry.path());
+	}
+
+	std::vector<std::string> hashes(files.size());
+	parallel_for(files.size(), thread_count, [&](size_t i) {
+		hashes[i] = blake3::to_string(blake3::hash_file(files[i]));
+	});
+
+	file_hashes result;
+	for (size_t i = 0; i < files.size(); i++) {
+		result.emplace(files[i].lexically_relative(directory)
+				.generic_string(), std::move(hashes[i]));
+	}
+	return result;
+}
+
+std::string get_package_digest(const file_hashes &files) {
+	blake3 hasher;
+	for (auto &[path, hash] : files) {
+		hasher.update(path);
+		hasher.update(std::string_view("\0", 1));
+		hasher.update(hash);
+		hasher.update("\n");
+	}
+	return blake3::to_string(hasher.finalize());
+}
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "pch.hpp"
+
+namespace util {
+
+// BLAKE3 hex digest of each file by its path relative
+// to the package directory, with forward slashes
+using file_hashes = std::map<std::string, std::string>;
+
+// Hashes regular files of the directory on up to "thread_count" threads
+file_hashes hash_directory(const std::filesystem::path &directory, size_t thread_count);
+
+// Package digest is BLAKE3 over "{path}\0{hash}\n" of each file in path order,
+// so it changes whenever a file is modified, added, removed or renamed
+std::string get_package_digest(const file_hashes &files);
+
+}
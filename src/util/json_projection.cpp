@@ -0,0 +1,213 @@
+#include "json_projection.hpp"
+
+namespace nl = nlohmann;
+
+static bool is_delimiter(char c) {
+	return c == ',' || c == '}' || c == ']' || std::isspace(static_cast<unsigned char>(c));
+}
+
+namespace util {
+
+json_projection::json_projection(std::vector<path> paths)
+		: paths(std::move(paths)) {}
+
+void json_projection::feed(std::string_view chunk) {
+	for (char c : chunk)
+		process(c);
+}
+
+nl::json json_projection::finish() {
+	if (malformed)
+		throw std::runtime_error("Malformed JSON.");
+	if (!done || current_region != region::tracked || in_string)
+		throw std::runtime_error("Unexpected end of JSON.");
+
+	nl::json result = nl::json::object();
+	for (auto &capture : captures) {
+		nl::json *target = &result;
+		for (auto &key : capture.first)
+			target = &(*target)[key];
+
+		*target = nl::json::parse(capture.second);
+	}
+
+	captures.clear();
+	return result;
+}
+
+void json_projection::process(char c) {
+	if (malformed)
+		return;
+
+	// Only whitespace may follow the document
+	if (done) {
+		if (!std::isspace(static_cast<unsigned char>(c)))
+			malformed = true;
+		return;
+	}
+
+	if (current_region != region::tracked) {
+		if (in_scalar && depth == 0 && is_delimiter(c)) {
+			end_value();
+			process(c);
+			return;
+		}
+
+		if (current_region == region::captured)
+			capture_buffer.push_back(c);
+
+		if (in_string) {
+			if (escaped)
+				escaped = false;
+			else if (c == '\\')
+				escaped = true;
+			else if (c == '"') {
+				in_string = false;
+				if (depth == 0)
+					end_value();
+			}
+		} else if (c == '"')
+			in_string = true;
+		else if (c == '{' || c == '[')
+			depth++;
+		else if ((c == '}' || c == ']') && --depth == 0)
+			end_value();
+
+		return;
+	}
+
+	if (reading_key) {
+		if (escaped)
+			escaped = false;
+		else if (c == '\\')
+			escaped = true;
+		else if (c == '"') {
+			reading_key = false;
+
+			if (key_buffer.find('\\') != std::string::npos)
+				key_buffer = nl::json::parse('"' + key_buffer + '"');
+			keys.back() = std::move(key_buffer);
+			key_buffer.clear();
+			return;
+		}
+
+		key_buffer.push_back(c);
+		return;
+	}
+
+	switch (c) {
+	case ' ': case '\t': case '\n': case '\r': case ':':
+		break;
+	case ',':
+		expect_key = !keys.empty();
+		break;
+	case '}':
+		if (keys.empty()) {
+			malformed = true;
+			break;
+		}
+
+		keys.pop_back();
+		expect_key = false;
+		if (keys.empty())
+			done = true;
+		break;
+	case '"':
+		if (expect_key) {
+			expect_key = false;
+			reading_key = true;
+			break;
+		}
+		[[fallthrough]];
+	default:
+		begin_value(c);
+	}
+}
+
+void json_projection::begin_value(char c) {
+	if (keys.empty() && c != '{') {
+		malformed = true;
+		return;
+	}
+
+	match match = match_path();
+
+	if (match == match::prefix && c == '{') {
+		if (is_wildcard_object())
+			captures.emplace_back(keys, "{}");
+
+		keys.emplace_back();
+		expect_key = true;
+		return;
+	}
+
+	current_region = (match == match::full)
+			? region::captured : region::skipped;
+
+	if (current_region == region::captured) {
+		capture_buffer.clear();
+		capture_buffer.push_back(c);
+	}
+
+	if (c == '{' || c == '[')
+		depth = 1;
+	else if (c == '"')
+		in_string = true;
+	else
+		in_scalar = true;
+}
+
+void json_projection::end_value() {
+	if (current_region == region::captured)
+		captures.emplace_back(keys, std::move(capture_buffer));
+
+	current_region = region::tracked;
+	in_scalar = false;
+	depth = 0;
+
+	if (keys.empty())
+		done = true;
+}
+
+json_projection::match json_projection::match_path() const {
+	if (paths.empty())
+		return match::full;
+
+	match result = match::none;
+	for (auto &path : paths) {
+		if (path.size() < keys.size())
+			continue;
+
+		if (!std::equal(keys.begin(), keys.end(), path.begin(),
+				[](auto &key, auto &element) {
+			return element == "*" || element == key;
+		}))
+			continue;
+
+		if (path.size() == keys.size())
+			return match::full;
+		result = match::prefix;
+	}
+
+	return result;
+}
+
+bool json_projection::is_wildcard_object() const {
+	for (auto &path : paths) {
+		if (path.size() <= keys.size())
+			continue;
+
+		if (!std::equal(keys.begin(), keys.end(), path.begin(),
+				[](auto &key, auto &element) {
+			return element == "*" || element == key;
+		}))
+			continue;
+
+		if (path[keys.size()] == "*" || (!keys.empty() && path[keys.size() - 1] == "*"))
+			return true;
+	}
+
+	return false;
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "pch.hpp"
+
+namespace util {
+
+// Incremental JSON reader which is fed with chunks as they arrive
+// and keeps only values found at requested paths. Path element "*"
+// matches any key, objects it matches in and their parents are kept
+// even if nothing in them was requested. Everything else is scanned
+// but never stored, so memory use depends on the projection and not
+// on the input. Input must be an object.
+class json_projection {
+public:
+	using path = std::vector<std::string>;
+
+	// Empty list keeps the whole document
+	json_projection(std::vector<path> paths = {});
+
+	void feed(std::string_view chunk);
+
+	// Throws if input was malformed or incomplete
+	nlohmann::json finish();
+
+private:
+	enum class region {
+		tracked, captured, skipped
+	};
+
+	enum class match {
+		none, prefix, full
+	};
+
+	std::vector<path> paths;
+
+	// Keys of objects on the way to requested values
+	std::vector<std::string> keys;
+	std::string key_buffer;
+	bool expect_key = false, reading_key = false, done = false, malformed = false;
+
+	region current_region = region::tracked;
+	uint32_t depth = 0;
+	bool in_string = false, escaped = false, in_scalar = false;
+
+	std::string capture_buffer;
+	std::vector<std::pair<path, std::string>> captures;
+
+	void process(char c);
+
+	void begin_value(char c);
+
+	void end_value();
+
+	match match_path() const;
+
+	// Object at the current keys is matched by "*" or holds its matches
+	bool is_wildcard_object() const;
+};
+
+}
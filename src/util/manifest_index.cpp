@@ -0,0 +1,423 @@
+#include "manifest_index.hpp"
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include "util/file.hpp"
+#include "util/file_lock.hpp"
+#include "common.hpp"
+
+namespace fs = std::filesystem;
+namespace nl = nlohmann;
+
+// File starts with this, the last byte is format version
+static constexpr std::string_view magic{ "VOLTIDX\x01", 8 };
+
+// Smaller files aren't rewritten to drop replaced records
+static constexpr size_t min_compacted_size = 1 << 20;
+
+// Which optional values of a manifest or release follow
+enum : uint8_t {
+	has_git = 1 << 0
+};
+
+enum : uint8_t {
+	has_created = 1 << 0,
+	has_tarball = 1 << 1,
+	has_tarball_strip = 1 << 2,
+	has_size = 1 << 3,
+	has_dependencies = 1 << 4
+};
+
+// Numbers are stored in native byte order, the index never leaves
+// the machine. Strings are prefixed by their length.
+template <typename T>
+static void append(std::string &out, T value) {
+	out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static void append_string(std::string &out, std::string_view str) {
+	append(out, static_cast<uint32_t>(str.size()));
+	out += str;
+}
+
+// Reads values of a record, throws if they're out of its bounds
+class record_reader {
+public:
+	record_reader(std::string_view data) : data(data) {}
+
+	template <typename T>
+	T read() {
+		if (data.size() < sizeof(T))
+			throw std::out_of_range("Truncated manifest record.");
+
+		T value;
+		std::memcpy(&value, data.data(), sizeof(T));
+		data.remove_prefix(sizeof(T));
+		return value;
+	}
+
+	std::string_view read_string() {
+		uint32_t length = read<uint32_t>();
+		if (data.size() < length)
+			throw std::out_of_range("Truncated manifest record.");
+
+		std::string_view str = data.substr(0, length);
+		data.remove_prefix(length);
+		return str;
+	}
+
+private:
+	std::string_view data;
+};
+
+// Size of the record, then the record itself
+static std::string encode(std::string_view id, const nl::json &manifest,
+		std::chrono::system_clock::time_point time) {
+	std::string record(sizeof(uint32_t), '\0');
+	append(record, static_cast<int64_t>(std::chrono::duration_cast<
+			std::chrono::milliseconds>(time.time_since_epoch()).count()));
+	append_string(record, id);
+
+	auto git = manifest.find("git");
+	bool git_valid = git != manifest.end() && git->is_string();
+	uint8_t flags = git_valid ? has_git : 0;
+	append(record, flags);
+	if (git_valid)
+		append_string(record, git->get_ref<const nl::json::string_t &>());
+
+	auto releases = manifest.find("releases");
+	if (releases == manifest.end() || !releases->is_object()) {
+		append(record, uint32_t(0));
+	} else {
+		append(record, static_cast<uint32_t>(releases->size()));
+
+		for (auto &[version, release] : releases->items()) {
+			append_string(record, version);
+
+			auto created = release.find("created");
+			auto tarball = release.find("tarball");
+			auto tarball_strip = release.find("tarballStrip");
+			auto size = release.find("size");
+			auto deps = release.find("dependencies");
+
+			flags = 0;
+			if (created != release.end() && created->is_string())
+				flags |= has_created;
+			if (tarball != release.end() && tarball->is_string())
+				flags |= has_tarball;
+			if (tarball_strip != release.end() && tarball_strip->is_number_unsigned())
+				flags |= has_tarball_strip;
+			if (size != release.end() && size->is_number_unsigned())
+				flags |= has_size;
+			if (deps != release.end() && deps->is_object())
+				flags |= has_dependencies;
+			append(record, flags);
+
+			if (flags & has_created)
+				append_string(record, created->get_ref<const nl::json::string_t &>());
+			if (flags & has_tarball)
+				append_string(record, tarball->get_ref<const nl::json::string_t &>());
+			if (flags & has_tarball_strip)
+				append(record, tarball_strip->get<uint32_t>());
+			if (flags & has_size)
+				append(record, size->get<uint64_t>());
+
+			if (flags & has_dependencies) {
+				// Ranges have to be strings, others are left out
+				uint32_t count = static_cast<uint32_t>(std::count_if(deps->begin(), deps->end(),
+						[](auto &range) { return range.is_string(); }));
+				append(record, count);
+
+				for (auto &[dep_id, range] : deps->items()) {
+					if (!range.is_string())
+						continue;
+					append_string(record, dep_id);
+					append_string(record, range.get_ref<const nl::json::string_t &>());
+				}
+			}
+		}
+	}
+
+	uint32_t size = static_cast<uint32_t>(record.size() - sizeof(uint32_t));
+	std::memcpy(record.data(), &size, sizeof(size));
+	return record;
+}
+
+// Reader positioned at the releases of a record
+static record_reader read_header(std::string_view record, nl::json *manifest) {
+	record_reader reader(record.substr(sizeof(uint32_t)));
+	reader.read<int64_t>();
+	reader.read_string();
+
+	uint8_t flags = reader.read<uint8_t>();
+	if (flags & has_git) {
+		std::string_view git = reader.read_string();
+		if (manifest)
+			(*manifest)["git"] = git;
+	}
+
+	return reader;
+}
+
+// Moves reader past a release or adds it to the manifest
+static void read_release(record_reader &reader, std::string_view version, nl::json *manifest) {
+	nl::json *release = manifest ? &(*manifest)["releases"][std::string(version)] : nullptr;
+	if (release)
+		*release = nl::json::object();
+
+	uint8_t flags = reader.read<uint8_t>();
+	if (flags & has_created) {
+		std::string_view created = reader.read_string();
+		if (release)
+			(*release)["created"] = created;
+	}
+	if (flags & has_tarball) {
+		std::string_view tarball = reader.read_string();
+		if (release)
+			(*release)["tarball"] = tarball;
+	}
+	if (flags & has_tarball_strip) {
+		uint32_t strip = reader.read<uint32_t>();
+		if (release)
+			(*release)["tarballStrip"] = strip;
+	}
+	if (flags & has_size) {
+		uint64_t size = reader.read<uint64_t>();
+		if (release)
+			(*release)["size"] = size;
+	}
+	if (flags & has_dependencies) {
+		nl::json *deps = release ? &((*release)["dependencies"] = nl::json::object()) : nullptr;
+		uint32_t count = reader.read<uint32_t>();
+
+		for (uint32_t i = 0; i < count; i++) {
+			std::string_view id = reader.read_string();
+			std::string_view range = reader.read_string();
+			if (deps)
+				(*deps)[std::string(id)] = range;
+		}
+	}
+}
+
+namespace util {
+
+manifest_index::manifest_index(fs::path path) : path(std::move(path)) {
+	map();
+	size_t valid_size = read_records();
+
+	size_t live_size = magic.size();
+	for (auto &[id, record] : records)
+		live_size += record.size();
+
+	// Torn by a crash during append or mostly replaced records
+	bool torn = valid_size != size;
+	if (!torn && (size < min_compacted_size || live_size * 2 > size))
+		return;
+
+	try {
+		util::file_lock lock(fs::path(this->path) += ".lock");
+
+		// Another process might have appended in the meantime
+		unmap();
+		map();
+		read_records();
+
+		std::string contents(magic);
+		for (auto &[id, record] : records)
+			contents += record;
+		util::write_file(this->path, contents);
+
+		unmap();
+		map();
+		read_records();
+	} catch (...) {
+		// Mapped elsewhere on Windows, it's retried next time
+	}
+}
+
+manifest_index::~manifest_index() {
+	unmap();
+}
+
+manifest_index &manifest_index::get() {
+	static manifest_index index(common::getenv("VOLT_PATH")
+			/ fs::path("cache") / "manifests.idx");
+	return index;
+}
+
+std::optional<manifest_index::time_point> manifest_index::get_time(std::string_view id) const {
+	auto it = records.find(id);
+	if (it == records.end())
+		return std::nullopt;
+
+	record_reader reader(it->second.substr(sizeof(uint32_t)));
+	return time_point(std::chrono::milliseconds(reader.read<int64_t>()));
+}
+
+bool manifest_index::has_release(std::string_view id, std::string_view release) const {
+	auto it = records.find(id);
+	if (it == records.end())
+		return false;
+
+	try {
+		record_reader reader = read_header(it->second, nullptr);
+		uint32_t count = reader.read<uint32_t>();
+
+		for (uint32_t i = 0; i < count; i++) {
+			if (reader.read_string() == release)
+				return true;
+			read_release(reader, {}, nullptr);
+		}
+	} catch (const std::out_of_range &) {}
+
+	return false;
+}
+
+nl::json manifest_index::find(std::string_view id) const {
+	auto it = records.find(id);
+	if (it == records.end())
+		return nullptr;
+
+	try {
+		nl::json manifest = nl::json::object();
+		record_reader reader = read_header(it->second, &manifest);
+		manifest["releases"] = nl::json::object();
+
+		uint32_t count = reader.read<uint32_t>();
+		for (uint32_t i = 0; i < count; i++)
+			read_release(reader, reader.read_string(), &manifest);
+
+		return manifest;
+	} catch (const std::out_of_range &) {
+		return nullptr;
+	}
+}
+
+void manifest_index::store(const std::vector<std::string> &ids,
+		const std::vector<nl::json> &manifests, const std::vector<time_point> &times) {
+	size_t first_added = added.size();
+
+	std::string contents;
+	for (size_t i = 0; i < ids.size(); i++) {
+		if (!manifests[i].is_object())
+			continue;
+
+		auto &record = added.emplace_back(encode(ids[i], manifests[i], times[i]));
+		contents += record;
+	}
+
+	if (contents.empty())
+		return;
+
+	for (size_t i = first_added; i < added.size(); i++) {
+		record_reader reader(std::string_view(added[i]).substr(sizeof(uint32_t)));
+		reader.read<int64_t>();
+		records[reader.read_string()] = added[i];
+	}
+
+	// Index is only a cache, commands don't fail without it
+	try {
+		util::file_lock lock(fs::path(path) += ".lock");
+
+		bool empty = !fs::exists(path) || fs::file_size(path) == 0;
+		std::ofstream stream(path, std::ofstream::binary | std::ofstream::app);
+		if (empty)
+			stream << magic;
+		stream << contents;
+	} catch (...) {}
+}
+
+void manifest_index::map() {
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER file_size;
+	if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping) {
+			data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			if (data) {
+				size = static_cast<size_t>(file_size.QuadPart);
+			} else {
+				CloseHandle(mapping);
+				mapping = nullptr;
+			}
+		}
+	}
+
+	// Mapping keeps the file open
+	CloseHandle(file);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return;
+
+	struct stat info;
+	if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+		void *address = ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (address != MAP_FAILED) {
+			data = static_cast<const char *>(address);
+			size = static_cast<size_t>(info.st_size);
+		}
+	}
+
+	// Mapping keeps the file open
+	::close(fd);
+#endif
+}
+
+void manifest_index::unmap() noexcept {
+	records.clear();
+	added.clear();
+
+	if (!data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mapping);
+	mapping = nullptr;
+#else
+	::munmap(const_cast<char *>(data), size);
+#endif
+
+	data = nullptr;
+	size = 0;
+}
+
+size_t manifest_index::read_records() {
+	std::string_view contents(data, size);
+	if (!contents.starts_with(magic))
+		return 0;
+
+	size_t offset = magic.size();
+	while (offset < contents.size()) {
+		try {
+			record_reader reader(contents.substr(offset));
+			uint32_t record_size = reader.read<uint32_t>();
+			if (contents.size() - offset - sizeof(uint32_t) < record_size)
+				break;
+
+			std::string_view record = contents.substr(offset, sizeof(uint32_t) + record_size);
+			reader = record_reader(record.substr(sizeof(uint32_t)));
+			reader.read<int64_t>();
+			records[reader.read_string()] = record;
+			offset += record.size();
+		} catch (const std::out_of_range &) {
+			break;
+		}
+	}
+
+	return offset;
+}
+
+}
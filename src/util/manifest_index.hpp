@@ -0,0 +1,65 @@
+#pragma once
+
+#include "pch.hpp"
+
+namespace util {
+
+// Manifests seen in archives, kept across runs in one binary file that
+// is memory-mapped on startup, so lookups don't parse any JSON. Only the
+// values needed to resolve and download packages are kept: Git URL and
+// release creation dates, dependencies, tarballs and sizes. Records are
+// appended as manifests arrive and replace earlier records of the same
+// package. The file is rewritten without them once they take up most
+// of it.
+class manifest_index {
+public:
+	using time_point = std::chrono::system_clock::time_point;
+
+	manifest_index(std::filesystem::path path);
+
+	manifest_index(const manifest_index &) = delete;
+
+	manifest_index &operator=(const manifest_index &) = delete;
+
+	~manifest_index();
+
+	// Index at "$VOLT_PATH/cache/manifests.idx"
+	static manifest_index &get();
+
+	// When the manifest was stored, empty if it wasn't
+	std::optional<time_point> get_time(std::string_view id) const;
+
+	// Doesn't build the manifest
+	bool has_release(std::string_view id, std::string_view release) const;
+
+	// Same shape as manifests of the archive, null if it isn't stored
+	nlohmann::json find(std::string_view id) const;
+
+	// Appends records of all manifests which aren't null at once,
+	// each one is as old as the response it came from
+	void store(const std::vector<std::string> &ids,
+			const std::vector<nlohmann::json> &manifests,
+			const std::vector<time_point> &times);
+
+private:
+	std::filesystem::path path;
+	// Contents of the file when it was opened
+	const char *data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE mapping = nullptr;
+#endif
+	// Records stored by this process
+	std::deque<std::string> added;
+	// Latest record of each package, IDs view the records
+	std::unordered_map<std::string_view, std::string_view> records;
+
+	void map();
+
+	void unmap() noexcept;
+
+	// Size of the valid part, records in it are indexed
+	size_t read_records();
+};
+
+}
@@ -0,0 +1,107 @@
+#include "package_store.hpp"
+
+#ifdef __linux__
+	#include <fcntl.h>
+	#include <linux/fs.h>
+	#include <sys/ioctl.h>
+	#include <unistd.h>
+#endif
+
+#include "util/file.hpp"
+#include "common.hpp"
+
+namespace fs = std::filesystem;
+
+#ifdef __linux__
+static bool reflink(const fs::path &source, const fs::path &target) {
+	int source_fd = ::open(source.c_str(), O_RDONLY);
+	if (source_fd == -1)
+		return false;
+
+	int target_fd = ::open(target.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+	bool cloned = target_fd != -1 && ::ioctl(target_fd, FICLONE, source_fd) == 0;
+
+	if (target_fd != -1)
+		::close(target_fd);
+	::close(source_fd);
+
+	if (target_fd != -1 && !cloned) {
+		std::error_code error;
+		fs::remove(target, error);
+	}
+
+	return cloned;
+}
+#endif
+
+// Reflinks share blocks until one side is modified, hardlinks share
+// the file itself, so editing an installed file in place changes
+// the object too. Copies are the last resort.
+static void materialize(const fs::path &object, const fs::path &target) {
+#ifdef __linux__
+	if (reflink(object, target)) {
+		fs::permissions(target, fs::status(object).permissions());
+		return;
+	}
+#endif
+
+	std::error_code error;
+	fs::create_hard_link(object, target, error);
+	if (!error)
+		return;
+
+	fs::copy_file(object, target);
+}
+
+namespace util {
+
+package_store::package_store(fs::path path) : path(std::move(path)) {
+	fs::create_directories(this->path / "objects");
+}
+
+package_store &package_store::get() {
+	static package_store store(common::getenv("VOLT_PATH") / fs::path("store"));
+	return store;
+}
+
+package_store::import_result package_store::import(
+		const fs::path &directory, size_t thread_count) const {
+	import_result result;
+	result.files = hash_directory(directory, thread_count);
+	result.file_count = result.files.size();
+
+	for (auto &[relative_path, hash] : result.files) {
+		fs::path file = directory / fs::path(relative_path);
+		fs::path object_path = get_object_path(hash);
+
+		if (fs::exists(object_path)) {
+			result.shared_bytes += fs::file_size(file);
+			fs::remove(file);
+		} else {
+			fs::create_directories(object_path.parent_path());
+
+			std::error_code error;
+			fs::rename(file, object_path, error);
+
+			// Store is on another file system
+			if (error) {
+				fs::path tmp_path = get_tmp_path(object_path);
+				fs::copy_file(file, tmp_path);
+				fs::rename(tmp_path, object_path);
+				fs::remove(file);
+			}
+
+			result.new_count++;
+		}
+
+		materialize(object_path, file);
+	}
+
+	return result;
+}
+
+fs::path package_store::get_object_path(std::string_view hash) const {
+	return path / "objects" / hash.substr(0, 2) / hash.substr(2);
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "pch.hpp"
+
+#include "util/integrity.hpp"
+
+namespace util {
+
+// Files of installed packages deduplicated by their BLAKE3 hash.
+// Objects live at "objects/{hash[0:2]}/{hash[2:]}" and package
+// directories get reflinks, hardlinks or copies of them, whichever
+// the file system supports first.
+class package_store {
+public:
+	struct import_result {
+		size_t file_count = 0, new_count = 0;
+		uint64_t shared_bytes = 0;
+		file_hashes files;
+	};
+
+	package_store(std::filesystem::path path);
+
+	// Store at "$VOLT_PATH/store/"
+	static package_store &get();
+
+	// Moves each file of the directory into the store unless
+	// its content is already there, then links it back in place.
+	// Files are hashed on up to "thread_count" threads.
+	import_result import(const std::filesystem::path &directory,
+			size_t thread_count = 1) const;
+
+private:
+	std::filesystem::path path;
+
+	std::filesystem::path get_object_path(std::string_view hash) const;
+};
+
+}
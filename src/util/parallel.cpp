@@ -0,0 +1,42 @@
+#include "parallel.hpp"
+
+namespace util {
+
+size_t get_thread_count() noexcept {
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void parallel_for(size_t count, size_t thread_count,
+		const std::function<void(size_t)> &fn) {
+	std::atomic<size_t> next_index = 0;
+	std::atomic<bool> failed = false;
+	std::exception_ptr error;
+	std::mutex error_mutex;
+
+	auto work = [&]() {
+		size_t index;
+		while (!failed && (index = next_index++) < count) {
+			try {
+				fn(index);
+			} catch (...) {
+				std::lock_guard lock(error_mutex);
+				if (!error)
+					error = std::current_exception();
+				failed = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < std::min(thread_count, count); i++)
+		workers.emplace_back(work);
+
+	work();
+	for (auto &worker : workers)
+		worker.join();
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+}
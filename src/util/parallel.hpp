@@ -0,0 +1,17 @@
+#pragma once
+
+#include "pch.hpp"
+
+namespace util {
+
+// Default number of threads for CPU-bound work
+size_t get_thread_count() noexcept;
+
+// Calls the function with each index from 0 to count on up to
+// "thread_count" threads, the calling thread included. Indices
+// are handed out in order. Once any call throws, remaining indices
+// are skipped and the first exception is rethrown.
+void parallel_for(size_t count, size_t thread_count,
+		const std::function<void(size_t)> &fn);
+
+}
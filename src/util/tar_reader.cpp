@@ -0,0 +1,319 @@
+#include "tar_reader.hpp"
+
+namespace fs = std::filesystem;
+
+static std::runtime_error corrupted_error() {
+	return std::runtime_error("Package archive is corrupted.");
+}
+
+// Numeric fields are octal text, or big-endian base-256 if high bit is set
+static uint64_t parse_number(const char *field, size_t size) {
+	uint64_t value = 0;
+
+	if (static_cast<uint8_t>(field[0]) & 0x80) {
+		value = static_cast<uint8_t>(field[0]) & 0x7f;
+		for (size_t i = 1; i < size; i++)
+			value = (value << 8) | static_cast<uint8_t>(field[i]);
+		return value;
+	}
+
+	for (size_t i = 0; i < size; i++) {
+		char c = field[i];
+		if (c == ' ')
+			continue;
+		if (c < '0' || c > '7')
+			break;
+
+		value = (value << 3) | (c - '0');
+	}
+
+	return value;
+}
+
+static std::string_view get_field(const char *field, size_t size) {
+	return std::string_view(field, std::find(field, field + size, '\0') - field);
+}
+
+namespace util {
+
+tar_reader::tar_reader(fs::path destination, uint32_t strip_components)
+		: destination(std::move(destination)), strip_components(strip_components) {}
+
+tar_reader::~tar_reader() {
+	if (archive_compression == compression::gzip)
+		inflateEnd(&inflater);
+}
+
+void tar_reader::feed(std::span<const std::byte> data) {
+	const char *ptr = reinterpret_cast<const char *>(data.data());
+	size_t size = data.size();
+
+	if (size == 0)
+		return;
+
+	if (archive_compression == compression::unknown) {
+		// Gzip magic, tar always starts with a name
+		if (static_cast<uint8_t>(ptr[0]) == 0x1f) {
+			inflater = {};
+			if (inflateInit2(&inflater, 16 + MAX_WBITS) != Z_OK)
+				throw std::runtime_error("Failed to initialize decompression.");
+
+			archive_compression = compression::gzip;
+			inflate_buffer.resize(64 * 1024);
+		} else
+			archive_compression = compression::none;
+	}
+
+	if (archive_compression == compression::gzip)
+		inflate(ptr, size);
+	else
+		process(ptr, size);
+}
+
+void tar_reader::finish() {
+	if (archive_compression == compression::gzip && !inflater_done)
+		throw std::runtime_error("Unexpected end of package archive.");
+
+	// Some writers omit end-of-archive blocks
+	if (!ended && (header_size != 0 || remaining != 0 || padding != 0))
+		throw std::runtime_error("Unexpected end of package archive.");
+
+}
+
+void tar_reader::inflate(const char *data, size_t size) {
+	inflater.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+	inflater.avail_in = static_cast<uInt>(size);
+
+	while (inflater.avail_in != 0) {
+		// Concatenated gzip members
+		if (inflater_done) {
+			if (inflateReset(&inflater) != Z_OK)
+				throw corrupted_error();
+			inflater_done = false;
+		}
+
+		do {
+			inflater.next_out = reinterpret_cast<Bytef *>(inflate_buffer.data());
+			inflater.avail_out = static_cast<uInt>(inflate_buffer.size());
+
+			int result = ::inflate(&inflater, Z_NO_FLUSH);
+			if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+				throw corrupted_error();
+
+			process(inflate_buffer.data(), inflate_buffer.size() - inflater.avail_out);
+
+			if (result == Z_STREAM_END) {
+				inflater_done = true;
+				break;
+			}
+		} while (inflater.avail_out == 0);
+	}
+}
+
+void tar_reader::process(const char *data, size_t size) {
+	while (size != 0 && !ended) {
+		if (remaining != 0) {
+			size_t count = std::min<uint64_t>(remaining, size);
+
+			if (kind == entry_kind::file)
+				file.write(data, count);
+			else if (kind != entry_kind::skipped)
+				metadata.append(data, count);
+
+			data += count;
+			size -= count;
+			remaining -= count;
+
+			if (remaining == 0)
+				end_entry();
+		} else if (padding != 0) {
+			size_t count = std::min<uint64_t>(padding, size);
+			data += count;
+			size -= count;
+			padding -= count;
+		} else {
+			size_t count = std::min(block_size - header_size, size);
+			std::copy(data, data + count, header.data() + header_size);
+			data += count;
+			size -= count;
+			header_size += count;
+
+			if (header_size == block_size) {
+				header_size = 0;
+				begin_entry();
+			}
+		}
+	}
+}
+
+void tar_reader::begin_entry() {
+	if (std::all_of(header.begin(), header.end(), [](char c) { return c == '\0'; })) {
+		ended = true;
+		return;
+	}
+
+	// Checksum is computed as if its own field was filled with spaces
+	uint64_t checksum = 0;
+	for (size_t i = 0; i < block_size; i++)
+		checksum += (i >= 148 && i < 156) ? ' ' : static_cast<uint8_t>(header[i]);
+	if (checksum != parse_number(&header[148], 8))
+		throw corrupted_error();
+
+	uint64_t size = parse_number(&header[124], 12);
+	char type = header[156];
+
+	std::string name = std::move(next_name);
+	next_name.clear();
+	if (name.empty()) {
+		name = get_field(&header[0], 100);
+
+		std::string_view prefix = get_field(&header[345], 155);
+		if (get_field(&header[257], 6) == "ustar" && !prefix.empty())
+			name = std::string(prefix) + '/' + name;
+	}
+
+	if (next_size) {
+		size = *next_size;
+		next_size.reset();
+	}
+
+	remaining = size;
+	padding = (block_size - size % block_size) % block_size;
+	kind = entry_kind::skipped;
+
+	switch (type) {
+	case '0': case '\0': case '7':
+		if (auto path = get_entry_path(name)) {
+			file_path = destination / *path;
+			fs::create_directories(file_path.parent_path());
+
+			file.open(file_path, std::ofstream::binary | std::ofstream::trunc);
+			if (!file)
+				throw std::runtime_error("Failed to create " + file_path.string() + '.');
+
+			executable = (parse_number(&header[100], 8) & 0111) != 0;
+			kind = entry_kind::file;
+		}
+		break;
+	case '5':
+		if (auto path = get_entry_path(name))
+			fs::create_directories(destination / *path);
+		break;
+	case '1': case '2':
+		throw std::runtime_error("Links in package archives are not supported.");
+	case 'L':
+		kind = entry_kind::long_name;
+		break;
+	case 'x':
+		kind = entry_kind::extended_header;
+		break;
+	default:
+		// Global headers, devices and FIFOs
+		break;
+	}
+
+	if (kind != entry_kind::skipped && kind != entry_kind::file)
+		metadata.clear();
+
+	if (remaining == 0)
+		end_entry();
+}
+
+void tar_reader::end_entry() {
+	switch (kind) {
+	case entry_kind::file:
+		file.close();
+		if (!file)
+			throw std::runtime_error("Failed to write " + file_path.string() + '.');
+
+#ifndef _WIN32
+		if (executable) {
+			fs::permissions(file_path, fs::perms::owner_exec | fs::perms::group_exec
+					| fs::perms::others_exec, fs::perm_options::add);
+		}
+#endif
+		break;
+	case entry_kind::long_name:
+		next_name = get_field(metadata.data(), metadata.size());
+		break;
+	case entry_kind::extended_header:
+		parse_extended_header();
+		break;
+	default:
+		break;
+	}
+
+	kind = entry_kind::skipped;
+}
+
+void tar_reader::parse_extended_header() {
+	// Records are "{length} {key}={value}\n"
+	std::string_view records = metadata;
+
+	while (!records.empty()) {
+		size_t space = records.find(' ');
+		if (space == std::string_view::npos)
+			throw corrupted_error();
+
+		size_t length = 0;
+		for (char c : records.substr(0, space)) {
+			if (c < '0' || c > '9')
+				throw corrupted_error();
+			length = length * 10 + (c - '0');
+		}
+
+		if (length <= space + 1 || length > records.size())
+			throw corrupted_error();
+
+		std::string_view record = records.substr(space + 1, length - space - 2);
+		records.remove_prefix(length);
+
+		size_t equals = record.find('=');
+		if (equals == std::string_view::npos)
+			continue;
+
+		std::string_view key = record.substr(0, equals);
+		std::string_view value = record.substr(equals + 1);
+
+		if (key == "path")
+			next_name = value;
+		else if (key == "size")
+			next_size = std::stoull(std::string(value));
+	}
+}
+
+std::optional<fs::path> tar_reader::get_entry_path(std::string_view name) const {
+	if (name.starts_with('/'))
+		throw std::runtime_error("Package archive contains absolute path: " + std::string(name));
+
+	fs::path path;
+	uint32_t stripped = 0;
+
+	size_t start = 0;
+	while (start <= name.size()) {
+		size_t end = std::min(name.find('/', start), name.size());
+		std::string_view component = name.substr(start, end - start);
+		start = end + 1;
+
+		if (component.empty() || component == ".")
+			continue;
+#ifdef _WIN32
+		if (component.find_first_of("\\:") != std::string_view::npos)
+			throw std::runtime_error("Package archive contains invalid path: " + std::string(name));
+#endif
+		if (component == "..")
+			throw std::runtime_error("Package archive contains path outside of it: " + std::string(name));
+
+		if (stripped < strip_components)
+			stripped++;
+		else
+			path /= component;
+	}
+
+	if (path.empty())
+		return std::nullopt;
+
+	return path;
+}
+
+}
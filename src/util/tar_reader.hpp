@@ -0,0 +1,74 @@
+#pragma once
+
+#include "pch.hpp"
+
+namespace util {
+
+// Extracts a tar archive, plain or gzip-compressed, while it is still
+// being received. File contents are written as soon as they arrive,
+// so the archive itself is never stored. Entries escaping destination
+// are rejected and links are not supported.
+class tar_reader {
+public:
+	// Leading path components are removed from entry names like
+	// "--strip-components" of tar, entries left empty are skipped
+	tar_reader(std::filesystem::path destination, uint32_t strip_components = 0);
+
+	tar_reader(const tar_reader &other) = delete;
+
+	~tar_reader();
+
+	tar_reader &operator=(const tar_reader &other) = delete;
+
+	void feed(std::span<const std::byte> data);
+
+	// Throws if archive was incomplete
+	void finish();
+
+private:
+	enum class compression {
+		unknown, none, gzip
+	};
+
+	enum class entry_kind {
+		file, skipped, long_name, extended_header
+	};
+
+	static constexpr size_t block_size = 512;
+
+	std::filesystem::path destination;
+	uint32_t strip_components;
+
+	compression archive_compression = compression::unknown;
+	z_stream inflater;
+	bool inflater_done = false;
+	std::vector<char> inflate_buffer;
+
+	std::array<char, block_size> header;
+	size_t header_size = 0;
+	bool ended = false;
+
+	entry_kind kind = entry_kind::skipped;
+	uint64_t remaining = 0, padding = 0;
+	std::ofstream file;
+	std::filesystem::path file_path;
+	bool executable = false;
+
+	// Long name or extended header of the next entry
+	std::string metadata, next_name;
+	std::optional<uint64_t> next_size;
+
+	void inflate(const char *data, size_t size);
+
+	void process(const char *data, size_t size);
+
+	void begin_entry();
+
+	void end_entry();
+
+	void parse_extended_header();
+
+	std::optional<std::filesystem::path> get_entry_path(std::string_view name) const;
+};
+
+}
@@ -132,8 +132,9 @@ int32_t version::compare(const version &other) const noexcept {
 	size_t b_size = other.pre_release.size();
 
 	size_t min_size = std::min(a_size, b_size);
+	// Version without pre-release tags takes precedence
 	if (min_size == 0)
-		return a_size == 0 ? 1 : -1;
+		return a_size == b_size ? 0 : (a_size == 0 ? 1 : -1);
 
 	for (size_t i = 0; i < min_size; i++) {
 		auto &a = pre_release[i];
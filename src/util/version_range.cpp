@@ -0,0 +1,201 @@
+#include "version_range.hpp"
+
+#include "util/string.hpp"
+
+// Version with some trailing parts missing, e.g. "1.2" or "1.x"
+struct partial_version {
+	util::version version;
+	// Number of parts given
+	size_t count = 0;
+};
+
+static util::version make_version(uint32_t major, uint32_t minor, uint32_t patch) {
+	return util::version(major, minor, patch, {}, {});
+}
+
+static bool is_wildcard(std::string_view part) {
+	return part == "*" || part == "x" || part == "X";
+}
+
+static partial_version parse_partial(std::string_view str) {
+	partial_version result;
+	size_t suffix_index = str.find_first_of("-+");
+	auto parts = util::split(str.substr(0, suffix_index), ".");
+
+	if (parts.empty() || parts.size() > 3)
+		throw std::invalid_argument("Invalid version in range.");
+
+	uint32_t numbers[3]{};
+	for (auto &part : parts) {
+		if (is_wildcard(part))
+			break;
+
+		if (part.empty() || !std::all_of(part.begin(), part.end(),
+				[](char c) { return std::isdigit(static_cast<unsigned char>(c)); }))
+			throw std::invalid_argument("Invalid version in range.");
+
+		numbers[result.count++] = std::stoul(part);
+	}
+
+	// Parts after a wildcard must be wildcards too
+	for (size_t i = result.count; i < parts.size(); i++) {
+		if (!is_wildcard(parts[i]))
+			throw std::invalid_argument("Invalid version in range.");
+	}
+
+	if (suffix_index != std::string_view::npos) {
+		// Pre-release and build metadata need a complete version
+		if (result.count != 3)
+			throw std::invalid_argument("Invalid version in range.");
+		result.version = util::version(std::string(str));
+	} else
+		result.version = make_version(numbers[0], numbers[1], numbers[2]);
+
+	return result;
+}
+
+namespace util {
+
+version_range::version_range(std::string_view str) : str(str) {
+	util::trim(this->str);
+
+	try {
+		for (size_t begin = 0; begin <= this->str.size();) {
+			size_t end = std::min(this->str.find("||", begin), this->str.size());
+			std::string_view alternative = std::string_view(this->str).substr(begin, end - begin);
+			begin = end + 2;
+
+			auto &comparators = alternatives.emplace_back();
+
+			// Operator may be separated from its version
+			std::string pending;
+			for (auto &token : util::split(alternative, " ", true)) {
+				if (token.find_first_not_of("<>=^~") == std::string::npos) {
+					pending += token;
+					continue;
+				}
+
+				parse_comparator(pending + token, comparators);
+				pending.clear();
+			}
+
+			if (!pending.empty())
+				throw std::invalid_argument("Operator without version.");
+		}
+	} catch (const std::exception &) {
+		throw std::invalid_argument("String is not a valid version range: " + this->str);
+	}
+
+	if (alternatives.size() == 1 && alternatives[0].size() == 1
+			&& alternatives[0][0].op == operation::equal)
+		exact = alternatives[0][0].version;
+}
+
+bool version_range::contains(const version &version) const noexcept {
+	bool pre_release = !version.get_pre_release().empty();
+
+	for (auto &comparators : alternatives) {
+		if (!std::all_of(comparators.begin(), comparators.end(),
+				[&version](auto &comparator) { return comparator.matches(version); }))
+			continue;
+
+		if (!pre_release || std::any_of(comparators.begin(), comparators.end(),
+				[&version](auto &comparator) {
+			auto &bound = comparator.version;
+			return !bound.get_pre_release().empty() && bound.major == version.major
+					&& bound.minor == version.minor && bound.patch == version.patch;
+		}))
+			return true;
+	}
+
+	return false;
+}
+
+const std::optional<version> &version_range::get_exact() const noexcept {
+	return exact;
+}
+
+std::ostream &operator<<(std::ostream &lhs, const version_range &rhs) {
+	return lhs << rhs.str;
+}
+
+bool version_range::comparator::matches(const util::version &other) const noexcept {
+	int32_t comparison = other.compare(version);
+
+	switch (op) {
+	case operation::less:
+		return comparison < 0;
+	case operation::less_equal:
+		return comparison <= 0;
+	case operation::equal:
+		return comparison == 0;
+	case operation::greater_equal:
+		return comparison >= 0;
+	default:
+		return comparison > 0;
+	}
+}
+
+void version_range::parse_comparator(std::string_view token, std::vector<comparator> &comparators) {
+	size_t version_index = token.find_first_not_of("<>=^~");
+	std::string_view op = token.substr(0, version_index);
+	std::string_view version_str = token.substr(version_index);
+
+	partial_version partial = parse_partial(version_str);
+	const util::version &lower = partial.version;
+	size_t count = partial.count;
+	uint32_t major = lower.major, minor = lower.minor, patch = lower.patch;
+
+	// Version after the last one that the given parts match
+	auto next = [&]() {
+		return count == 1 ? make_version(major + 1, 0, 0)
+				: make_version(major, minor + 1, 0);
+	};
+
+	if (count == 0) {
+		// Nothing is above or below every version
+		if (op == "<" || op == ">")
+			comparators.push_back({ operation::less, make_version(0, 0, 0) });
+		else if (!op.empty() && op != "^" && op != "~" && op != ">=" && op != "<=" && op != "=")
+			throw std::invalid_argument("Unknown operator.");
+		return;
+	}
+
+	if (op == "^") {
+		comparators.push_back({ operation::greater_equal, lower });
+
+		if (major != 0 || count == 1)
+			comparators.push_back({ operation::less, make_version(major + 1, 0, 0) });
+		else if (minor != 0 || count == 2)
+			comparators.push_back({ operation::less, make_version(0, minor + 1, 0) });
+		else
+			comparators.push_back({ operation::less, make_version(0, 0, patch + 1) });
+	} else if (op == "~") {
+		comparators.push_back({ operation::greater_equal, lower });
+		comparators.push_back({ operation::less, next() });
+	} else if (op == ">=") {
+		comparators.push_back({ operation::greater_equal, lower });
+	} else if (op == "<") {
+		comparators.push_back({ operation::less, lower });
+	} else if (op == ">") {
+		if (count == 3)
+			comparators.push_back({ operation::greater, lower });
+		else
+			comparators.push_back({ operation::greater_equal, next() });
+	} else if (op == "<=") {
+		if (count == 3)
+			comparators.push_back({ operation::less_equal, lower });
+		else
+			comparators.push_back({ operation::less, next() });
+	} else if (op.empty() || op == "=") {
+		if (count == 3)
+			comparators.push_back({ operation::equal, lower });
+		else {
+			comparators.push_back({ operation::greater_equal, lower });
+			comparators.push_back({ operation::less, next() });
+		}
+	} else
+		throw std::invalid_argument("Unknown operator.");
+}
+
+}
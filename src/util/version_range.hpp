@@ -0,0 +1,46 @@
+#pragma once
+
+#include "pch.hpp"
+
+#include "version.hpp"
+
+namespace util {
+
+// Set of versions a dependency accepts. Same syntax as npm:
+// "1.2.3" or "=1.2.3" (exact), "^1.2", "~0.3.1", ">=1.0 <2.0",
+// "1.x", "*" and alternatives joined by "||". Missing parts
+// of a version are zeros in bounds and wildcards otherwise.
+class version_range {
+public:
+	version_range(std::string_view str);
+
+	// Pre-release versions only match comparators
+	// with a pre-release of the same version
+	bool contains(const version &version) const noexcept;
+
+	// Set if only one version matches, e.g. "1.2.3"
+	const std::optional<version> &get_exact() const noexcept;
+
+	friend std::ostream &operator<<(std::ostream &lhs, const version_range &rhs);
+
+private:
+	enum class operation {
+		less, less_equal, equal, greater_equal, greater
+	};
+
+	struct comparator {
+		operation op;
+		util::version version;
+
+		bool matches(const util::version &other) const noexcept;
+	};
+
+	// Alternatives of comparators which all have to match
+	std::vector<std::vector<comparator>> alternatives;
+	std::optional<version> exact;
+	std::string str;
+
+	void parse_comparator(std::string_view token, std::vector<comparator> &comparators);
+};
+
+}
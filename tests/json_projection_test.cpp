@@ -0,0 +1,48 @@
+#include "test.hpp"
+
+#include "util/json_projection.hpp"
+
+namespace nl = nlohmann;
+
+static const std::vector<util::json_projection::path> manifest_fields{
+	{ "git" }, { "releases", "*", "created" }
+};
+
+// Fed one character at a time, so every state crosses a chunk boundary
+static nl::json project(std::string_view input) {
+	util::json_projection projection(manifest_fields);
+	for (size_t i = 0; i < input.size(); i++)
+		projection.feed(input.substr(i, 1));
+	return projection.finish();
+}
+
+static bool rejects(std::string_view input) {
+	return test::throws([input]() { project(input); });
+}
+
+namespace test {
+
+void json_projection() {
+	check(rejects("<html><body><h1>502 Bad Gateway</h1></body></html>"), "error page");
+	check(rejects("garbage"), "bare word");
+	check(rejects("[1,2]"), "top-level array");
+	check(rejects("\"releases\""), "top-level string");
+	check(rejects("{\"a\":1}}}}"), "trailing brackets");
+	check(rejects("{\"a\":1} {}"), "second document");
+	check(rejects("}"), "closing bracket");
+	check(rejects(""), "empty input");
+	check(rejects("{\"releases\":{\"1.0.0\":{"), "truncated object");
+
+	check(project("{\"releases\":{}}") == nl::json::parse("{\"releases\":{}}"),
+			"no releases");
+	check(project("{\"releases\":{\"1.0.0\":{\"size\":1}}}")
+			== nl::json::parse("{\"releases\":{\"1.0.0\":{}}}"), "release without fields");
+	check(project("{\"id\":\"a/b\"}") == nl::json::object(), "no requested fields");
+
+	check(project(" {\"git\":\"https://example.com/a.git\",\"description\":\"}{\","
+			"\"releases\":{\"1.0.0\":{\"created\":\"2022-01-01\",\"dependencies\":{}}}}\n")
+			== nl::json::parse("{\"git\":\"https://example.com/a.git\","
+			"\"releases\":{\"1.0.0\":{\"created\":\"2022-01-01\"}}}"), "manifest");
+}
+
+}
@@ -0,0 +1,247 @@
+#include "test.hpp"
+
+#include "util/file.hpp"
+#include "util/integrity.hpp"
+#include "util/string.hpp"
+#include "downloader.hpp"
+#include "lockfile.hpp"
+#include "resolver.hpp"
+
+namespace fs = std::filesystem;
+namespace nl = nlohmann;
+using test::check;
+
+static const nl::json package = nl::json::parse(R"({
+	"id": "r/root", "version": "1.0.0", "dependencies": { "a/x": "^1.0" }
+})");
+
+// Root depends on "a/x", which depends on "a/y"
+static resolver::resolution make_resolution() {
+	resolver::resolution resolution;
+	auto &graph = resolution.graph;
+	resolver::node_index root = graph.add("r/root", util::version("1.0.0"),
+			resolver::dependency::none);
+	resolver::node_index x = graph.add("a/x", util::version("1.2.0"), root);
+	resolver::node_index y = graph.add("a/y", util::version("2.0.0"), x);
+
+	resolution.packages = { x, y };
+	resolution.depths[graph[x].name] = 1;
+	resolution.depths[graph[y].name] = 2;
+
+	resolution.manifests["a/x"] = nl::json::parse(R"({
+		"git": "https://example.com/x.git",
+		"releases": { "1.2.0": {
+			"tarball": "https://example.com/x-1.2.0.tar.gz", "tarballStrip": 1,
+			"size": 1024, "dependencies": { "a/y": "^2.0" }
+		} }
+	})");
+	resolution.manifests["a/y"] = nl::json::parse(R"({
+		"git": "https://example.com/y.git", "releases": { "2.0.0": { "dependencies": {} } }
+	})");
+	return resolution;
+}
+
+static const nl::json integrity = nl::json::parse(R"({
+	"a/x": { "version": "1.2.0", "digest": "x-digest" },
+	"a/y": { "version": "1.0.0", "digest": "digest-of-another-version" }
+})");
+
+// Rewrites the lockfile after the callback changed it
+static void edit(const fs::path &path, const std::function<void(nl::json &)> &callback) {
+	nl::json lock = nl::json::parse(util::read_file(path));
+	callback(lock);
+	util::write_file(path, lock.dump());
+}
+
+static void test_round_trip(const fs::path &directory) {
+	fs::path path = lockfile::get_path(directory / "package.json");
+	std::string inputs = lockfile::get_inputs_hash(package.dump());
+	lockfile::write(path, inputs, make_resolution(), integrity);
+
+	auto locked = lockfile::read(path, inputs, package);
+	check(locked.has_value(), "lockfile is read");
+	if (!locked)
+		return;
+
+	auto &graph = locked->graph;
+	std::vector<std::string> packages;
+	for (resolver::node_index index : locked->packages)
+		packages.push_back(graph[index].get_str() + ' ' + std::to_string(locked->depths[graph[index].name]));
+	check(packages == std::vector<std::string>{ "a/x 1.2.0 1", "a/y 2.0.0 2" },
+			"versions and depths");
+
+	auto &x = locked->manifests["a/x"];
+	check(x["git"] == "https://example.com/x.git", "git URL");
+	check(x["releases"]["1.2.0"] == nl::json::parse(R"({
+		"tarball": "https://example.com/x-1.2.0.tar.gz", "tarballStrip": 1,
+		"size": 1024, "digest": "x-digest"
+	})"), "release source and digest");
+	check(!locked->manifests["a/y"]["releases"]["2.0.0"].contains("digest"),
+			"digest of another version isn't recorded");
+
+	auto jobs = downloader::get_jobs(*locked);
+	check(jobs.size() == 2 && jobs[0].digest == "x-digest" && jobs[1].digest.empty(),
+			"download jobs check locked digest");
+
+	auto records = lockfile::read_packages(path, inputs);
+	check(records.is_array() && records[0]["dependencies"] == nl::json::parse(R"({ "a/y": "^2.0" })"),
+			"dependencies of records");
+
+	check(!lockfile::read(path, lockfile::get_inputs_hash("{}"), package),
+			"other inputs aren't locked");
+}
+
+static void test_malformed(const fs::path &directory) {
+	fs::path path = lockfile::get_path(directory / "package.json");
+	std::string inputs = lockfile::get_inputs_hash(package.dump());
+	auto reads = [&]() { return lockfile::read(path, inputs, package).has_value(); };
+
+	lockfile::write(path, inputs, make_resolution(), integrity);
+	edit(path, [](nl::json &lock) { lock["packages"][0].erase("depth"); });
+	check(!reads(), "record without depth");
+
+	lockfile::write(path, inputs, make_resolution(), integrity);
+	edit(path, [](nl::json &lock) { lock["packages"][1]["version"] = "latest"; });
+	check(!reads(), "invalid version");
+
+	lockfile::write(path, inputs, make_resolution(), integrity);
+	edit(path, [](nl::json &lock) {
+		lock["packages"][1].erase("git");
+	});
+	check(!reads(), "package without source which isn't installed");
+
+	util::write_file(path, "[]");
+	check(!reads(), "top level isn't an object");
+
+	util::write_file(path, "{\"inputs\":");
+	check(!reads(), "truncated file");
+
+	fs::remove(path);
+	check(!reads(), "missing file");
+}
+
+// Package installed by another process is checked like a downloaded one
+static void test_digest(const fs::path &directory) {
+	fs::path path = lockfile::get_path(directory / "package.json");
+	std::string inputs = lockfile::get_inputs_hash(package.dump());
+	lockfile::write(path, inputs, make_resolution(), integrity);
+
+	auto locked = lockfile::read(path, inputs, package);
+	check(locked.has_value(), "lockfile for digest is read");
+	if (!locked)
+		return;
+
+	auto jobs = downloader::get_jobs(*locked);
+	fs::path package_path = jobs[0].path;
+	fs::create_directories(package_path);
+	util::write_file(package_path / "package.json", "{}");
+
+	std::vector<downloader::download_job> mismatched{ jobs[0] };
+	check(downloader::download(mismatched, 1) == 1, "mismatched digest fails");
+
+	std::vector<downloader::download_job> matching{ jobs[0] };
+	matching[0].digest = util::get_package_digest(util::hash_directory(package_path, 1));
+	check(downloader::download(matching, 1) == 0, "matching digest succeeds");
+	check(matching[0].files.contains("package.json"), "files are hashed");
+}
+
+// Manifests given as JSON, kept for the phases after solving
+class fixture_provider : public resolver::manifest_provider {
+public:
+	fixture_provider(std::string_view manifests) : manifests(nl::json::parse(manifests)) {}
+
+	std::vector<const nl::json *> load(const std::vector<solver::request> &requests) override {
+		std::vector<const nl::json *> result;
+		for (auto &request : requests) {
+			auto it = manifests.find(request.id);
+			result.push_back(it == manifests.end() ? nullptr : &*it);
+		}
+		return result;
+	}
+
+	bool is_partial(std::string_view) const override {
+		return false;
+	}
+
+	const nl::json &get_manifest(const std::string &id) override {
+		return manifests[id];
+	}
+
+private:
+	nl::json manifests;
+};
+
+// "a/x" depends on releases of "a/y" which don't exist and on "a/v",
+// which the root overrides with "b/v". "a/z" depends on existing "a/y".
+static constexpr std::string_view removal_manifests = R"({
+	"a/x": { "releases": { "1.0.0": { "dependencies": { "a/y": "^1.0", "a/v": "^1.0" } } } },
+	"a/y": { "releases": { "2.0.0": { "dependencies": {} } } },
+	"a/z": { "releases": { "1.0.0": { "dependencies": { "a/y": "^2.0" } } } },
+	"b/v": { "releases": { "3.0.0": { "dependencies": {} } } }
+})";
+
+static resolver::resolution resolve(const nl::json &root, fixture_provider &provider) {
+	auto solution = solver::solve(root, provider);
+	auto tree = resolver::build_tree(root, solution, provider);
+	auto depths = resolver::compute_depths(root, tree, provider);
+	auto resolution = resolver::flatten(std::move(tree), depths);
+	for (auto &selection : solution.packages)
+		resolution.manifests[selection.id] = provider.get_manifest(selection.id);
+	return resolution;
+}
+
+// "{id} {version} {depth}" of each record, sorted
+static std::vector<std::string> get_records(const fs::path &path, std::string_view inputs) {
+	std::vector<std::string> records;
+	for (auto &record : lockfile::read_packages(path, inputs)) {
+		records.push_back(record["id"].get<std::string>() + ' '
+				+ record["version"].get<std::string>() + ' '
+				+ std::to_string(record["depth"].get<uint32_t>()));
+	}
+	std::sort(records.begin(), records.end());
+	return records;
+}
+
+// Removal without resolving keeps what a full resolution would select
+static void test_remove_dependency(const fs::path &directory) {
+	fs::path path = lockfile::get_path(directory / "package.json");
+	fs::path expected_path = directory / "expected-lock.json";
+	fixture_provider provider(removal_manifests);
+
+	nl::json root = nl::json::parse(R"({ "id": "r/root", "version": "1.0.0",
+		"dependencies": { "a/x": "^1.0", "a/z": "^1.0", "b/v": "^3.0" } })");
+	std::string previous_inputs = lockfile::get_inputs_hash(root.dump());
+	lockfile::write(path, previous_inputs, resolve(root, provider), nullptr);
+	check(get_records(path, previous_inputs) == std::vector<std::string>{
+			"a/x 1.0.0 1", "a/y 2.0.0 2", "a/z 1.0.0 1", "b/v 3.0.0 2" }, "locked before removal");
+
+	root["dependencies"].erase("a/z");
+	std::string inputs = lockfile::get_inputs_hash(root.dump());
+	lockfile::write(expected_path, inputs, resolve(root, provider), nullptr);
+
+	auto removed = lockfile::remove_dependency(path, previous_inputs, inputs, root, "z");
+	if (removed)
+		std::sort(removed->begin(), removed->end());
+	check(removed == std::vector<std::string>{ "a/y", "a/z" }, "removed packages");
+	check(get_records(path, inputs) == get_records(expected_path, inputs),
+			"same records as full resolution");
+
+	// Needed package depends on the removed name, which was overridden
+	nl::json without_override = root;
+	without_override["dependencies"].erase("b/v");
+	check(!lockfile::remove_dependency(path, inputs,
+			lockfile::get_inputs_hash(without_override.dump()), without_override, "v"),
+			"overridden dependency is resolved");
+}
+
+namespace test {
+
+void lockfile() {
+	temp_directory directory;
+	test_round_trip(directory.get_path());
+	test_malformed(directory.get_path());
+	test_digest(directory.get_path());
+	test_remove_dependency(directory.get_path());
+}
+
+}
@@ -0,0 +1,78 @@
+#include "test.hpp"
+
+namespace fs = std::filesystem;
+
+static size_t failure_count = 0;
+
+static const std::map<std::string_view, void (*)()> groups{
+	{ "json_projection", test::json_projection },
+	{ "lockfile", test::lockfile },
+	{ "manifest_index", test::manifest_index },
+	{ "solver", test::solver },
+	{ "tar_reader", test::tar_reader },
+	{ "version_range", test::version_range }
+};
+
+namespace test {
+
+void check(bool condition, std::string_view name) {
+	if (!condition) {
+		std::cout << "Failed: " << name << '\n';
+		failure_count++;
+	}
+}
+
+temp_directory::temp_directory() {
+	static std::atomic<uint32_t> counter = 0;
+	path = fs::temp_directory_path() / ("volt-test-" + std::to_string(
+			std::chrono::steady_clock::now().time_since_epoch().count())
+			+ '-' + std::to_string(counter++));
+	fs::create_directories(path);
+}
+
+temp_directory::~temp_directory() {
+	std::error_code error;
+	fs::remove_all(path, error);
+}
+
+const fs::path &temp_directory::get_path() const noexcept {
+	return path;
+}
+
+}
+
+// Runs the group given as the argument, or all of them
+int main(int argc, char *argv[]) {
+	// Packages and caches go to a scratch directory
+	test::temp_directory volt_directory;
+#ifdef _WIN32
+	_putenv_s("VOLT_PATH", volt_directory.get_path().string().c_str());
+#else
+	::setenv("VOLT_PATH", volt_directory.get_path().c_str(), 1);
+#endif
+
+	for (auto &[name, group] : groups) {
+		if (argc > 1 && name != argv[1])
+			continue;
+
+		try {
+			group();
+		} catch (const std::exception &e) {
+			std::cout << "Failed: " << name << " threw: " << e.what() << '\n';
+			failure_count++;
+		}
+	}
+
+	if (argc > 1 && !groups.contains(argv[1])) {
+		std::cout << "Unknown test group: " << argv[1] << '\n';
+		return EXIT_FAILURE;
+	}
+
+	if (failure_count != 0) {
+		std::cout << failure_count << " checks failed.\n";
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "All checks passed.\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+#include "test.hpp"
+
+#include "util/manifest_index.hpp"
+
+namespace fs = std::filesystem;
+namespace nl = nlohmann;
+using test::check;
+using time_point = util::manifest_index::time_point;
+
+// Index keeps milliseconds
+static time_point get_time(int64_t milliseconds) {
+	return time_point(std::chrono::milliseconds(milliseconds));
+}
+
+static const nl::json full_manifest = nl::json::parse(R"({
+	"id": "a/full",
+	"description": "Not indexed.",
+	"git": "https://example.com/full.git",
+	"releases": {
+		"1.0.0": {
+			"created": "2022-01-01T00:00:00.000Z",
+			"tarball": "https://example.com/full-1.0.0.tar.gz",
+			"tarballStrip": 1,
+			"size": 4096,
+			"dependencies": { "a/dep": "^1.0", "a/invalid": 1 }
+		},
+		"1.1.0": { "created": "2022-02-01T00:00:00.000Z" }
+	}
+})");
+
+static const nl::json indexed_manifest = nl::json::parse(R"({
+	"git": "https://example.com/full.git",
+	"releases": {
+		"1.0.0": {
+			"created": "2022-01-01T00:00:00.000Z",
+			"tarball": "https://example.com/full-1.0.0.tar.gz",
+			"tarballStrip": 1,
+			"size": 4096,
+			"dependencies": { "a/dep": "^1.0" }
+		},
+		"1.1.0": { "created": "2022-02-01T00:00:00.000Z" }
+	}
+})");
+
+static nl::json make_manifest(std::string_view release) {
+	nl::json manifest;
+	manifest["releases"][std::string(release)] = nl::json::object();
+	return manifest;
+}
+
+static void test_round_trip(const fs::path &path) {
+	{
+		util::manifest_index index(path);
+		check(index.find("a/full").is_null() && !index.get_time("a/full"), "empty index");
+
+		index.store({ "a/full", "a/missing", "a/other" },
+				{ full_manifest, nullptr, make_manifest("2.0.0") },
+				{ get_time(1000), get_time(2000), get_time(3000) });
+
+		check(index.find("a/full") == indexed_manifest, "values used by resolution");
+		check(index.get_time("a/full") == get_time(1000), "response time");
+		check(index.find("a/missing").is_null(), "null manifest isn't stored");
+		check(index.has_release("a/full", "1.1.0") && index.has_release("a/other", "2.0.0"),
+				"stored releases");
+		check(!index.has_release("a/full", "2.0.0") && !index.has_release("a/none", "1.0.0"),
+				"releases which aren't stored");
+	}
+
+	util::manifest_index index(path);
+	check(index.find("a/full") == indexed_manifest, "mapped after reopening");
+	check(index.get_time("a/other") == get_time(3000), "time after reopening");
+}
+
+static void test_replacement(const fs::path &path) {
+	{
+		util::manifest_index index(path);
+		index.store({ "a/full" }, { make_manifest("3.0.0") }, { get_time(4000) });
+		check(index.find("a/full") == make_manifest("3.0.0"), "newer record in same process");
+	}
+
+	util::manifest_index index(path);
+	check(index.find("a/full") == make_manifest("3.0.0"), "newer record after reopening");
+	check(index.get_time("a/full") == get_time(4000), "time of newer record");
+	check(!index.has_release("a/full", "1.0.0"), "releases of older record are gone");
+}
+
+static void test_torn_tail(const fs::path &path) {
+	uintmax_t valid_size = fs::file_size(path);
+	{
+		util::manifest_index index(path);
+		index.store({ "a/torn" }, { full_manifest }, { get_time(5000) });
+	}
+
+	// Crash in the middle of appending
+	fs::resize_file(path, valid_size + (fs::file_size(path) - valid_size) / 2);
+	{
+		util::manifest_index index(path);
+		check(index.find("a/torn").is_null(), "partial record is ignored");
+		check(index.find("a/other") == make_manifest("2.0.0")
+				&& index.find("a/full") == make_manifest("3.0.0"), "records before it are kept");
+	}
+
+	// Rewritten without the partial record and without replaced records
+	uintmax_t compacted_size = fs::file_size(path);
+	check(compacted_size < valid_size, "file is compacted");
+
+	{
+		util::manifest_index index(path);
+		index.store({ "a/torn" }, { make_manifest("1.0.0") }, { get_time(6000) });
+	}
+
+	util::manifest_index index(path);
+	check(index.find("a/torn") == make_manifest("1.0.0"), "records are appended after compaction");
+	check(index.find("a/other") == make_manifest("2.0.0"), "records survive compaction");
+}
+
+static void test_foreign_file(const fs::path &path) {
+	std::ofstream(path, std::ofstream::binary | std::ofstream::trunc) << "not an index";
+	{
+		util::manifest_index index(path);
+		check(index.find("a/other").is_null(), "file without magic has no records");
+		index.store({ "a/other" }, { make_manifest("2.0.0") }, { get_time(7000) });
+	}
+
+	util::manifest_index index(path);
+	check(index.find("a/other") == make_manifest("2.0.0"), "foreign file is replaced");
+}
+
+namespace test {
+
+void manifest_index() {
+	temp_directory directory;
+	fs::path path = directory.get_path() / "manifests.idx";
+
+	test_round_trip(path);
+	test_replacement(path);
+	test_torn_tail(path);
+	test_foreign_file(path);
+}
+
+}
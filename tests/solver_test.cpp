@@ -0,0 +1,208 @@
+#include "test.hpp"
+
+#include "solver.hpp"
+
+namespace nl = nlohmann;
+using test::check;
+
+// Manifests given as JSON, packages missing from it aren't found
+class fixture_source : public solver::manifest_source {
+public:
+	std::vector<std::string> requested;
+
+	fixture_source(std::string_view manifests, std::set<std::string> partial = {})
+			: manifests(nl::json::parse(manifests)), partial(std::move(partial)) {}
+
+	std::vector<const nl::json *> load(const std::vector<solver::request> &requests) override {
+		std::vector<const nl::json *> result;
+		for (auto &request : requests) {
+			requested.emplace_back(request.id);
+			auto it = manifests.find(request.id);
+			result.push_back(it == manifests.end() ? nullptr : &*it);
+		}
+		return result;
+	}
+
+	bool is_partial(std::string_view id) const override {
+		return partial.contains(std::string(id));
+	}
+
+private:
+	nl::json manifests;
+	std::set<std::string> partial;
+};
+
+static nl::json make_package(std::string_view dependencies) {
+	nl::json package;
+	package["id"] = "r/root";
+	package["version"] = "1.0.0";
+	package["dependencies"] = nl::json::parse(dependencies);
+	return package;
+}
+
+// "{id} {version}" of each selection, sorted
+static std::vector<std::string> get_selected(const solver::solution &solution) {
+	std::vector<std::string> selected;
+	for (auto &selection : solution.packages)
+		selected.push_back(selection.id + ' ' + selection.release);
+	std::sort(selected.begin(), selected.end());
+	return selected;
+}
+
+static std::vector<std::string> solve(std::string_view dependencies, fixture_source &source) {
+	return get_selected(solver::solve(make_package(dependencies), source));
+}
+
+// Message of the exception, empty if solving succeeded
+static std::string get_error(std::string_view dependencies, fixture_source &source) {
+	try {
+		solver::solve(make_package(dependencies), source);
+		return {};
+	} catch (const std::exception &e) {
+		return e.what();
+	}
+}
+
+static bool contains(std::string_view str, std::string_view part) {
+	return str.find(part) != std::string_view::npos;
+}
+
+// Two releases of "a/x" need different releases of "a/y",
+// and "a/z" only works with the older one
+static constexpr std::string_view backtracking_manifests = R"({
+	"a/x": { "releases": {
+		"1.0.0": { "dependencies": { "a/y": "^1.0" } },
+		"2.0.0": { "dependencies": { "a/y": "^2.0" } }
+	} },
+	"a/y": { "releases": { "1.0.0": {}, "2.0.0": {} } },
+	"a/z": { "releases": { "1.0.0": { "dependencies": { "a/y": "1.0.0" } } } }
+})";
+
+static void test_selection() {
+	fixture_source source(R"({
+		"a/x": { "releases": {
+			"1.0.0": {}, "1.2.0": { "dependencies": { "a/y": "~0.1" } },
+			"1.3.0-beta": {}, "2.0.0": {}, "invalid": {}
+		} },
+		"a/y": { "releases": { "0.1.0": {}, "0.1.5": {}, "0.2.0": {} } }
+	})");
+
+	check(solve(R"({ "a/x": "^1.0" })", source)
+			== std::vector<std::string>{ "a/x 1.2.0", "a/y 0.1.5" }, "newest in range");
+	check(source.requested == std::vector<std::string>{ "a/x", "a/y" }, "each ID requested once");
+}
+
+static void test_backtracking() {
+	fixture_source source(backtracking_manifests);
+	check(solve(R"({ "a/x": "*", "a/z": "*" })", source) == std::vector<std::string>{
+			"a/x 1.0.0", "a/y 1.0.0", "a/z 1.0.0" }, "older release of dependant");
+
+	// Newest "a/foo" only fails once its dependencies are decided, through
+	// a release of "a/shared" which conflicts with a dependency of "a/bar"
+	fixture_source partial_satisfier(R"({
+		"a/foo": { "releases": {
+			"1.0.0": {},
+			"1.1.0": { "dependencies": { "a/left": "^1.0.0", "a/right": "^1.0.0" } }
+		} },
+		"a/left": { "releases": { "1.0.0": { "dependencies": { "a/shared": ">=1.0.0" } } } },
+		"a/right": { "releases": { "1.0.0": { "dependencies": { "a/shared": "<2.0.0" } } } },
+		"a/shared": { "releases": {
+			"1.0.0": { "dependencies": { "a/target": "^1.0.0" } }, "2.0.0": {}
+		} },
+		"a/target": { "releases": { "1.0.0": {}, "2.0.0": {} } },
+		"a/bar": { "releases": { "1.0.0": { "dependencies": { "a/target": "^2.0.0" } } } }
+	})");
+	auto solution = solver::solve(make_package(
+			R"({ "a/foo": "^1.0.0", "a/bar": "*" })"), partial_satisfier);
+	check(get_selected(solution) == std::vector<std::string>{
+			"a/bar 1.0.0", "a/foo 1.0.0", "a/target 2.0.0" }, "older release after conflict");
+	// Root and each selection are decided once without backtracking
+	check(solution.decision_count > solution.packages.size() + 1, "decisions are undone");
+}
+
+static void test_root_override() {
+	fixture_source source(R"({
+		"a/x": { "releases": { "1.0.0": { "dependencies": { "b/y": "^2.0" } } } },
+		"a/y": { "releases": { "1.0.0": {}, "2.0.0": {} } },
+		"b/y": { "releases": { "2.0.0": {} } }
+	})");
+
+	check(solve(R"({ "a/x": "*", "a/y": "1.0.0" })", source)
+			== std::vector<std::string>{ "a/x 1.0.0", "a/y 1.0.0" },
+			"root dependency overrides name in another scope");
+	check(std::find(source.requested.begin(), source.requested.end(), "b/y")
+			== source.requested.end(), "overridden dependency isn't requested");
+}
+
+static void test_left_out() {
+	fixture_source source(R"({
+		"a/x": { "releases": { "1.0.0": { "dependencies": { "a/y": "^2.0" } } } },
+		"a/y": { "releases": { "1.0.0": {} } }
+	})");
+
+	check(solve(R"({ "a/x": "*" })", source) == std::vector<std::string>{ "a/x 1.0.0" },
+			"dependency on removed release is left out");
+}
+
+static void test_partial() {
+	fixture_source source(R"({
+		"a/x": { "releases": { "1.0.0": { "dependencies": { "a/y": "^2.0" } } } },
+		"a/y": { "releases": { "1.0.0": {} } }
+	})", { "a/y" });
+
+	std::string error = get_error(R"({ "a/x": "*" })", source);
+	check(contains(error, "a/x 1.0.0 depends on a/y ^2.0"),
+			"dependency outside of partial manifest conflicts");
+}
+
+static void test_conflicts() {
+	fixture_source backtracking(backtracking_manifests);
+	std::string error = get_error(R"({ "a/x": "^2.0", "a/z": "*" })", backtracking);
+	check(contains(error, "Dependencies can't be resolved:\n(1) Because "),
+			"explanation lists derived conflicts");
+	check(contains(error, "a/z 1.0.0 depends on a/y 1.0.0"), "explanation names the cause");
+	check(contains(error, "r/root depends on a/x ^2.0"), "explanation reaches the root");
+	check(error.ends_with("Please override this conflict with another top-level dependency."),
+			"explanation suggests an override");
+
+	fixture_source missing("{}");
+	error = get_error(R"({ "a/x": "1.0.0" })", missing);
+	check(contains(error, "a/x 1.0.0, which wasn't found in any archive"), "missing package");
+
+	fixture_source no_release(R"({ "a/x": { "releases": { "1.0.0": {} } } })");
+	error = get_error(R"({ "a/x": "^2.0" })", no_release);
+	check(contains(error, "a/x ^2.0, which has no matching release"), "no matching release");
+
+	fixture_source invalid(R"({
+		"a/x": { "releases": { "1.0.0": { "dependencies": { "a/y": ">=>1" } } } }
+	})");
+	error = get_error(R"({ "a/x": "*" })", invalid);
+	check(contains(error, "a/x has an invalid dependency"), "invalid range");
+}
+
+static void test_same_name() {
+	fixture_source source(R"({
+		"a/x": { "releases": { "1.0.0": { "dependencies": { "b/z": "*" } } } },
+		"a/y": { "releases": { "1.0.0": { "dependencies": { "c/z": "*" } } } },
+		"b/z": { "releases": { "1.0.0": {} } },
+		"c/z": { "releases": { "1.0.0": {} } }
+	})");
+
+	std::string error = get_error(R"({ "a/x": "*", "a/y": "*" })", source);
+	check(contains(error, "share a name, only one of them can be installed"),
+			"one package of each name");
+}
+
+namespace test {
+
+void solver() {
+	test_selection();
+	test_backtracking();
+	test_root_override();
+	test_left_out();
+	test_partial();
+	test_conflicts();
+	test_same_name();
+}
+
+}
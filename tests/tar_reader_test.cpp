@@ -0,0 +1,175 @@
+#include "test.hpp"
+
+#include "util/file.hpp"
+#include "util/tar_reader.hpp"
+
+namespace fs = std::filesystem;
+using test::check;
+
+// Header block of a ustar entry with a valid checksum
+static std::string make_header(std::string_view name, char type,
+		size_t size, std::string_view mode = "0000644") {
+	std::string header(512, '\0');
+	std::copy(name.begin(), name.end(), header.begin());
+	std::copy(mode.begin(), mode.end(), header.begin() + 100);
+
+	char size_field[12];
+	std::snprintf(size_field, sizeof(size_field), "%011zo", size);
+	std::copy(size_field, size_field + 11, header.begin() + 124);
+
+	header[156] = type;
+	std::copy_n("ustar\0" "00", 8, header.begin() + 257);
+
+	std::fill_n(header.begin() + 148, 8, ' ');
+	uint64_t checksum = 0;
+	for (char c : header)
+		checksum += static_cast<uint8_t>(c);
+
+	char checksum_field[8];
+	std::snprintf(checksum_field, sizeof(checksum_field), "%06llo",
+			static_cast<unsigned long long>(checksum));
+	std::copy(checksum_field, checksum_field + 7, header.begin() + 148);
+	return header;
+}
+
+// Header, contents and padding to the next block
+static std::string make_entry(std::string_view name, std::string_view contents,
+		char type = '0', std::string_view mode = "0000644") {
+	std::string entry = make_header(name, type, contents.size(), mode);
+	entry += contents;
+	entry.append((512 - contents.size() % 512) % 512, '\0');
+	return entry;
+}
+
+static std::string end_of_archive() {
+	return std::string(1024, '\0');
+}
+
+static std::string gzip(std::string_view data) {
+	z_stream stream{};
+	deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+	std::string result(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+	stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+	stream.avail_in = static_cast<uInt>(data.size());
+	stream.next_out = reinterpret_cast<Bytef *>(result.data());
+	stream.avail_out = static_cast<uInt>(result.size());
+	deflate(&stream, Z_FINISH);
+	result.resize(stream.total_out);
+	deflateEnd(&stream);
+	return result;
+}
+
+// Fed in small chunks, so headers and contents cross chunk boundaries
+static void extract(const fs::path &destination, std::string_view archive,
+		uint32_t strip_components = 0) {
+	util::tar_reader reader(destination, strip_components);
+	for (size_t i = 0; i < archive.size(); i += 100) {
+		auto chunk = archive.substr(i, 100);
+		reader.feed(std::as_bytes(std::span(chunk.data(), chunk.size())));
+	}
+	reader.finish();
+}
+
+static bool rejects(std::string_view archive, uint32_t strip_components = 0) {
+	test::temp_directory directory;
+	fs::path destination = directory.get_path() / "package";
+	bool thrown = test::throws([&]() { extract(destination, archive, strip_components); });
+
+	// Nothing may be written next to the destination
+	size_t outside_count = std::distance(fs::directory_iterator(directory.get_path()),
+			fs::directory_iterator());
+	return thrown && outside_count <= 1;
+}
+
+static void test_extraction() {
+	test::temp_directory directory;
+	std::string archive = make_entry("src/", "", '5') + make_entry("src/a.txt", "contents")
+			+ make_entry("run.sh", "#!/bin/sh\n", '0', "0000755")
+			+ make_entry("big.bin", std::string(1300, 'x')) + end_of_archive();
+
+	extract(directory.get_path(), archive);
+	check(util::read_file(directory.get_path() / "src" / "a.txt") == "contents", "file contents");
+	check(util::read_file(directory.get_path() / "big.bin") == std::string(1300, 'x'),
+			"contents over several blocks");
+#ifndef _WIN32
+	check((fs::status(directory.get_path() / "run.sh").permissions()
+			& fs::perms::owner_exec) != fs::perms::none, "executable bit");
+#endif
+
+	test::temp_directory gzipped;
+	extract(gzipped.get_path(), gzip(archive));
+	check(util::read_file(gzipped.get_path() / "src" / "a.txt") == "contents", "gzip");
+
+	test::temp_directory unterminated;
+	extract(unterminated.get_path(), make_entry("a.txt", "a"));
+	check(fs::exists(unterminated.get_path() / "a.txt"), "no end-of-archive blocks");
+}
+
+static void test_strip() {
+	test::temp_directory directory;
+	std::string archive = make_entry("package-1.0.0/", "", '5')
+			+ make_entry("package-1.0.0/include/a.hpp", "a")
+			+ make_entry("./package-1.0.0/b.txt", "b")
+			+ make_entry("top.txt", "top") + end_of_archive();
+
+	extract(directory.get_path(), archive, 1);
+	check(util::read_file(directory.get_path() / "include" / "a.hpp") == "a", "component stripped");
+	check(util::read_file(directory.get_path() / "b.txt") == "b", "dot isn't a component");
+	check(!fs::exists(directory.get_path() / "top.txt")
+			&& !fs::exists(directory.get_path() / "package-1.0.0"), "entries left empty are skipped");
+}
+
+static void test_long_names() {
+	std::string long_name = std::string(120, 'd') + "/file.txt";
+
+	test::temp_directory gnu;
+	extract(gnu.get_path(), make_entry("././@LongLink", long_name + '\0', 'L')
+			+ make_entry("truncated", "gnu") + end_of_archive());
+	check(util::read_file(gnu.get_path() / long_name) == "gnu", "GNU long name");
+
+	std::string record = "path=" + long_name + '\n';
+	std::string length = std::to_string(record.size() + 4);
+	test::temp_directory pax;
+	extract(pax.get_path(), make_entry("PaxHeader", length + ' ' + record, 'x')
+			+ make_entry("truncated", "pax") + end_of_archive());
+	check(util::read_file(pax.get_path() / long_name) == "pax", "PAX path");
+}
+
+static void test_rejected() {
+	check(rejects(make_entry("../evil.txt", "x") + end_of_archive()), "parent directory");
+	check(rejects(make_entry("a/../../evil.txt", "x") + end_of_archive()), "parent after a directory");
+	check(rejects(make_entry("package/../../evil.txt", "x") + end_of_archive(), 1),
+			"parent in stripped components");
+	check(rejects(make_entry("/tmp/evil.txt", "x") + end_of_archive()), "absolute path");
+	check(rejects(make_entry("a.txt", "x") + make_header("link", '2', 0) + end_of_archive()),
+			"symbolic link");
+	check(rejects(make_entry("a.txt", "x") + make_header("link", '1', 0) + end_of_archive()),
+			"hard link");
+
+	std::string record = "path=../evil.txt\n";
+	check(rejects(make_entry("PaxHeader", std::to_string(record.size() + 3) + ' ' + record, 'x')
+			+ make_entry("a.txt", "x") + end_of_archive()), "parent in PAX path");
+
+	std::string entry = make_entry("a.txt", "contents");
+	check(rejects(entry.substr(0, 300)), "truncated header");
+	check(rejects(entry.substr(0, 520)), "truncated contents");
+
+	std::string tampered = entry;
+	tampered[0] = 'b';
+	check(rejects(tampered + end_of_archive()), "wrong checksum");
+
+	std::string compressed = gzip(entry + end_of_archive());
+	check(rejects(compressed.substr(0, compressed.size() / 2)), "truncated gzip");
+}
+
+namespace test {
+
+void tar_reader() {
+	test_extraction();
+	test_strip();
+	test_long_names();
+	test_rejected();
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "pch.hpp"
+
+// Checks print what failed and keep going, the group fails if any did
+namespace test {
+
+void check(bool condition, std::string_view name);
+
+// Whether the function throws any standard exception
+template<typename F>
+bool throws(F &&function) {
+	try {
+		function();
+		return false;
+	} catch (const std::exception &) {
+		return true;
+	}
+}
+
+// Empty directory in the system temporary directory, removed with all
+// its contents on destruction
+class temp_directory {
+public:
+	temp_directory();
+
+	temp_directory(const temp_directory &) = delete;
+
+	temp_directory &operator=(const temp_directory &) = delete;
+
+	~temp_directory();
+
+	const std::filesystem::path &get_path() const noexcept;
+
+private:
+	std::filesystem::path path;
+};
+
+// Groups, each one is a CTest test
+void json_projection();
+
+void lockfile();
+
+void manifest_index();
+
+void solver();
+
+void tar_reader();
+
+void version_range();
+
+}
@@ -0,0 +1,66 @@
+#include "test.hpp"
+
+#include "util/version_range.hpp"
+
+// Range contains exactly the given versions out of the listed candidates
+static bool matches(std::string_view range_str, const std::vector<std::string> &inside,
+		const std::vector<std::string> &outside) {
+	util::version_range range(range_str);
+	return std::all_of(inside.begin(), inside.end(),
+			[&range](auto &version) { return range.contains(util::version(version)); })
+			&& std::none_of(outside.begin(), outside.end(),
+			[&range](auto &version) { return range.contains(util::version(version)); });
+}
+
+static bool rejects(std::string_view range_str) {
+	return test::throws([range_str]() { util::version_range range(range_str); });
+}
+
+namespace test {
+
+void version_range() {
+	check(matches("1.2.3", { "1.2.3" }, { "1.2.2", "1.2.4", "1.3.0" }), "exact");
+	check(matches("=1.2.3", { "1.2.3" }, { "1.2.4" }), "exact with operator");
+	check(util::version_range("1.2.3").get_exact() == util::version("1.2.3"),
+			"exact version");
+	check(!util::version_range("^1.2.3").get_exact(), "range isn't exact");
+	check(!util::version_range("1.2.3 || 1.2.4").get_exact(), "alternatives aren't exact");
+
+	check(matches("^1.2", { "1.2.0", "1.9.9" }, { "1.1.9", "2.0.0" }), "caret");
+	check(matches("^0.3.1", { "0.3.1", "0.3.9" }, { "0.3.0", "0.4.0" }), "caret below 1.0");
+	check(matches("^0.0.3", { "0.0.3" }, { "0.0.4", "0.1.0" }), "caret below 0.1");
+	check(matches("~0.3.1", { "0.3.1", "0.3.5" }, { "0.3.0", "0.4.0" }), "tilde");
+	check(matches("~1", { "1.0.0", "1.5.0" }, { "2.0.0" }), "tilde of major");
+
+	check(matches(">=1.0 <2.0", { "1.0.0", "1.9.9" }, { "0.9.9", "2.0.0" }), "bounds");
+	check(matches(">= 1.0  < 2.0", { "1.5.0" }, { "2.0.0" }), "operators apart");
+	check(matches(">1.2", { "1.3.0" }, { "1.2.9" }), "greater than partial");
+	check(matches(">1.2.3", { "1.2.4" }, { "1.2.3" }), "greater than complete");
+	check(matches("<=1.2", { "1.2.9" }, { "1.3.0" }), "at most partial");
+	check(matches("<1.2.3", { "1.2.2" }, { "1.2.3" }), "less than");
+
+	check(matches("1.x", { "1.0.0", "1.9.0" }, { "0.9.0", "2.0.0" }), "wildcard minor");
+	check(matches("1.2.*", { "1.2.0", "1.2.7" }, { "1.3.0" }), "wildcard patch");
+	check(matches("*", { "0.0.1", "3.2.1" }, {}), "any");
+	check(matches("", { "1.0.0" }, {}), "empty is any");
+	check(matches("<*", {}, { "0.0.0", "1.0.0" }), "below any");
+
+	check(matches("1.0.0 || 2.x || ^3.1", { "1.0.0", "2.4.0", "3.2.0" },
+			{ "1.1.0", "3.0.0", "4.0.0" }), "alternatives");
+
+	check(matches("^1.0.0", {}, { "1.1.0-beta" }), "no pre-release of another version");
+	check(matches(">=1.1.0-alpha <2", { "1.1.0-beta", "1.1.0", "1.5.0" },
+			{ "1.2.0-beta", "1.1.0-0" }), "pre-release of the same version");
+	check(matches("1.0.0-rc.1", { "1.0.0-rc.1" }, { "1.0.0-rc.2", "1.0.0" }),
+			"exact pre-release");
+
+	check(rejects("1.2.3.4"), "four parts");
+	check(rejects("abc"), "not a version");
+	check(rejects(">="), "operator without version");
+	check(rejects("1.x.2"), "part after wildcard");
+	check(rejects("1.2-beta"), "pre-release of partial version");
+	check(rejects("!1.0"), "unknown operator");
+	check(rejects("1..2"), "empty part");
+}
+
+}